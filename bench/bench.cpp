@@ -0,0 +1,360 @@
+/* hldp_bench - measures the bit reader primitives, per-frame-type decoding
+ * cost and end-to-end parsing throughput over synthetic demos.
+ *
+ * Usage: hldp_bench [--sizes MiB[,MiB...]] [--seed N] [--dir PATH] [--keep]
+ *        hldp_bench --generate PATH [--size MiB] [--seed N]
+ *
+ * The movement kernels are also checked against their scalar reference.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "generator.hpp"
+
+#include "analysis/movement.hpp"
+
+#include "parser/demo.hpp"
+#include "parser/frames.hpp"
+#include "parser/layout.hpp"
+#include "parser/parser.hpp"
+
+#include "utils/bitbuffer.hpp"
+#include "utils/filebuffer.hpp"
+#include "utils/misc.hpp"
+
+namespace
+{
+  using clock_type = std::chrono::steady_clock;
+
+  constexpr std::uint64_t mib = 1 << 20;
+  constexpr int repetitions = 5;
+
+  /* Keeps results alive, so that the measured work is not optimized away. */
+  volatile std::uint64_t sink = 0;
+
+  /* Runs ``f`` several times and returns the fastest run, in seconds. */
+  template<typename F>
+  double best_of(F &&f)
+  {
+    double best = 0.0;
+    for (int i = 0; i != repetitions; ++i) {
+      const auto start = clock_type::now();
+      f();
+      const std::chrono::duration<double> elapsed = clock_type::now() - start;
+      if (i == 0 || elapsed.count() < best) {
+        best = elapsed.count();
+      }
+    }
+    return best;
+  }
+
+  void print_header(std::string_view title)
+  {
+    fmt::print("\n{}\n{:<36} {:>12} {:>12} {:>14}\n", title, "benchmark", "ns/op", "MB/s", "ops/s");
+  }
+
+  void print_result(std::string_view name, double seconds, std::uint64_t ops, std::uint64_t bytes)
+  {
+    fmt::print(
+      "{:<36} {:>12.2f} {:>12.1f} {:>14.0f}\n",
+      name,
+      seconds * 1e9 / static_cast<double>(ops),
+      static_cast<double>(bytes) / 1e6 / seconds,
+      static_cast<double>(ops) / seconds
+    );
+  }
+
+  bit_buffer::data_t random_bytes(std::size_t n, std::uint64_t seed)
+  {
+    bench::rng rng(seed);
+    bit_buffer::data_t data(n);
+    for (auto &b : data) {
+      b = static_cast<bit_buffer::ubyte_t>(rng.next());
+    }
+    return data;
+  }
+
+  void bench_bit_reader(std::uint64_t seed)
+  {
+    print_header("bit reader primitives");
+
+    constexpr std::size_t size = 16 * mib;
+    const auto data = random_bytes(size, seed);
+
+    struct case_t
+    {
+      bit_buffer::ubyte_t width;
+      bit_buffer::ubyte_t offset; // bits skipped up front
+    };
+    constexpr case_t cases[] = {
+      {8, 0}, {16, 0}, {32, 0}, {64, 0},
+      {1, 3}, {5, 3}, {8, 3}, {13, 3}, {16, 3}, {27, 3}, {32, 3}, {57, 3}
+    };
+    for (const auto &c : cases) {
+      const std::uint64_t reads = (size * 8 - 64) / c.width;
+      const auto seconds = best_of([&] {
+        bit_buffer bb(data.data(), size);
+        bb.skip_bits(c.offset);
+        std::uint64_t acc = 0;
+        for (std::uint64_t i = 0; i != reads; ++i) {
+          acc += bb.read_bits(c.width);
+        }
+        sink = acc;
+      });
+      print_result(
+        fmt::format("read_bits({:>2}) {}", c.width, c.offset == 0 ? "aligned" : "unaligned"),
+        seconds,
+        reads,
+        reads * c.width / 8
+      );
+    }
+
+    for (const std::size_t amt : {4, 64, 1400}) {
+      const std::uint64_t reads = size / amt - 1;
+      const auto seconds = best_of([&] {
+        bit_buffer bb(data.data(), size);
+        std::uint64_t acc = 0;
+        for (std::uint64_t i = 0; i != reads; ++i) {
+          acc += bb.read_bytes(amt).size();
+        }
+        sink = acc;
+      });
+      print_result(fmt::format("read_bytes({})", amt), seconds, reads, reads * amt);
+    }
+
+    {
+      const std::uint64_t reads = size / sizeof(float) - 2;
+      const auto seconds = best_of([&] {
+        bit_buffer bb(data.data(), size);
+        float acc = 0.0f;
+        for (std::uint64_t i = 0; i != reads; ++i) {
+          acc += bb.read<float>();
+        }
+        sink = static_cast<std::uint64_t>(acc != 0.0f);
+      });
+      print_result("read<float>", seconds, reads, reads * sizeof(float));
+    }
+
+    {
+      constexpr std::size_t len = DEMO_CONST(demo::frame, seg_console_command_size);
+      const std::uint64_t reads = size / len - 1;
+      const auto seconds = best_of([&] {
+        bit_buffer bb(data.data(), size);
+        std::uint64_t acc = 0;
+        for (std::uint64_t i = 0; i != reads; ++i) {
+          acc += bb.read_string(len).size();
+        }
+        sink = acc;
+      });
+      print_result(fmt::format("read_string({})", len), seconds, reads, reads * len);
+    }
+  }
+
+  void bench_frame_types(std::uint64_t seed)
+  {
+    using type_e = demo::frame::type_e;
+
+    print_header("per-frame-type decoding");
+
+    constexpr std::size_t count = 100000;
+    const std::pair<type_e, std::string_view> types[] = {
+      {static_cast<type_e>(1), "game_data"},
+      {type_e::client_data, "client_data"},
+      {type_e::console_command, "console_command"},
+      {type_e::event, "event"},
+      {type_e::weapon_anim, "weapon_anim"},
+      {type_e::sound, "sound"},
+      {type_e::demo_buffer, "demo_buffer"}
+    };
+    for (const auto &[type, name] : types) {
+      bench::demo_generator gen({.seed = seed});
+      auto data = gen.frames_of(type, count);
+      const auto size = data.size();
+      data.resize(size + sizeof(bit_buffer::value_t));
+
+      const auto seconds = best_of([&] {
+        bit_buffer bb(data.data(), size);
+        std::uint64_t acc = 0;
+        for (std::size_t i = 0; i != count; ++i) {
+          frames::read_frame<default_layout>(bb, [&](const auto &f) { acc += f.frame_no; });
+        }
+        sink = acc;
+      });
+      print_result(name, seconds, count, size);
+    }
+  }
+
+  void bench_movement(std::uint64_t seed)
+  {
+    using analysis::isa_e;
+
+    print_header("movement kernels (ops = samples)");
+
+    constexpr std::size_t n = 1 << 22;
+    bench::rng rng(seed);
+    std::vector<float> vx(n), vy(n), yaw(n), frame_time(n);
+    std::vector<std::int32_t> onground(n);
+    float angle = 0.0f;
+    for (std::size_t i = 0; i != n; ++i) {
+      vx[i] = (rng.uniform() * 2.0f - 1.0f) * 400.0f;
+      vy[i] = (rng.uniform() * 2.0f - 1.0f) * 400.0f;
+      angle += (rng.uniform() * 2.0f - 1.0f) * 30.0f;
+      yaw[i] = angle;
+      frame_time[i] = rng.chance(0.01f) ? 0.0f : 0.001f + rng.uniform() * 0.02f;
+      onground[i] = rng.chance(0.9f);
+    }
+
+    constexpr std::pair<isa_e, std::string_view> isas[] = {
+      {isa_e::scalar, "scalar"},
+      {isa_e::sse2, "sse2"},
+      {isa_e::avx2, "avx2"}
+    };
+    const auto same = [](const std::vector<float> &a, const std::vector<float> &b) {
+      return std::memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+    };
+
+    std::vector<float> speed_ref(n), accel_ref(n), yaw_ref(n);
+    std::vector<std::size_t> jumps_ref;
+    for (const auto threads : {1u, 0u}) {
+      for (const auto &[isa, name] : isas) {
+        if (utils::to_underlying(isa) > utils::to_underlying(analysis::best_isa())) {
+          continue;
+        }
+        const analysis::kernel_options opts{.isa = isa, .threads = threads};
+        const auto suffix = fmt::format("{}{}", name, threads == 1 ? "" : " mt");
+
+        std::vector<float> speed(n), accel(n), deltas(n);
+        std::vector<std::size_t> jumps;
+        auto seconds = best_of([&] { analysis::horizontal_speed(vx, vy, speed, opts); });
+        print_result(fmt::format("horizontal_speed {}", suffix), seconds, n, n * 2 * sizeof(float));
+        seconds = best_of([&] { analysis::acceleration(speed, frame_time, accel, opts); });
+        print_result(fmt::format("acceleration {}", suffix), seconds, n, n * 2 * sizeof(float));
+        seconds = best_of([&] { analysis::yaw_deltas(yaw, deltas, opts); });
+        print_result(fmt::format("yaw_deltas {}", suffix), seconds, n, n * sizeof(float));
+        seconds = best_of([&] { jumps = analysis::jump_events(onground, opts); });
+        print_result(fmt::format("jump_events {}", suffix), seconds, n, n * sizeof(std::int32_t));
+
+        if (isa == isa_e::scalar && threads == 1) {
+          speed_ref = speed;
+          accel_ref = accel;
+          yaw_ref = deltas;
+          jumps_ref = jumps;
+        } else if (
+          !same(speed, speed_ref) || !same(accel, accel_ref)
+          || !same(deltas, yaw_ref) || jumps != jumps_ref
+        ) {
+          fmt::print("MISMATCH: {} differs from the scalar reference\n", suffix);
+        }
+      }
+    }
+  }
+
+  void bench_end_to_end(
+    const std::vector<std::uint64_t> &sizes,
+    std::uint64_t seed,
+    const std::filesystem::path &dir,
+    bool keep
+  )
+  {
+    print_header("end-to-end (ops = frames)");
+
+    std::filesystem::create_directories(dir);
+    for (const auto size : sizes) {
+      const auto path = dir / fmt::format("synthetic_{}mib_{}.dem", size / mib, seed);
+      bench::demo_generator gen({.seed = seed, .target_size = size});
+      const auto stats = gen.write(path);
+
+      const auto load = best_of([&] {
+        file_buffer fb(path);
+        sink = fb.size();
+      });
+      print_result(fmt::format("file_buffer load {} MiB", size / mib), load, 1, stats.size);
+
+      std::uint64_t frames = 0;
+      const auto open = best_of([&] {
+        parser p(path);
+        frames = 0;
+        for (const auto &index : p.get_demo().frame_index) {
+          frames += index.size();
+        }
+      });
+      print_result(fmt::format("parser construct {} MiB", size / mib), open, frames, stats.size);
+
+      parser p(path);
+      const auto parse = best_of([&] { p.parse(); });
+      print_result(fmt::format("parse_frames {} MiB", size / mib), parse, frames, stats.size);
+
+      if (!keep) {
+        std::filesystem::remove(path);
+      }
+    }
+  }
+
+  std::vector<std::uint64_t> parse_sizes(std::string_view list)
+  {
+    std::vector<std::uint64_t> sizes;
+    while (!list.empty()) {
+      const auto comma = list.find(',');
+      sizes.push_back(std::stoull(std::string(list.substr(0, comma))) * mib);
+      list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+    }
+    return sizes;
+  }
+} // namespace
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::uint64_t> sizes = {1 * mib, 16 * mib, 128 * mib};
+  std::uint64_t seed = 1;
+  std::uint64_t generate_size = 16 * mib;
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "hldp_bench";
+  std::filesystem::path generate;
+  bool keep = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--sizes" && has_value) {
+      sizes = parse_sizes(argv[++i]);
+    } else if (arg == "--size" && has_value) {
+      generate_size = std::stoull(argv[++i]) * mib;
+    } else if (arg == "--seed" && has_value) {
+      seed = std::stoull(argv[++i]);
+    } else if (arg == "--dir" && has_value) {
+      dir = argv[++i];
+    } else if (arg == "--generate" && has_value) {
+      generate = argv[++i];
+    } else if (arg == "--keep") {
+      keep = true;
+    } else {
+      fmt::print(stderr,
+        "usage: {0} [--sizes MiB[,MiB...]] [--seed N] [--dir PATH] [--keep]\n"
+        "       {0} --generate PATH [--size MiB] [--seed N]\n",
+        argv[0]
+      );
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!generate.empty()) {
+    bench::demo_generator gen({.seed = seed, .target_size = generate_size});
+    const auto stats = gen.write(generate);
+    fmt::print("wrote {} ({} bytes, {} frames)\n", generate.string(), stats.size, stats.total_frames());
+    return EXIT_SUCCESS;
+  }
+
+  bench_bit_reader(seed);
+  bench_frame_types(seed);
+  bench_movement(seed);
+  bench_end_to_end(sizes, seed, dir, keep);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,427 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "parser/demo.hpp"
+#include "parser/frames.hpp"
+#include "parser/layout.hpp"
+
+#include "utils/bitbuffer.hpp"
+#include "utils/misc.hpp"
+
+namespace bench
+{
+namespace
+{
+  /* Little-endian byte sink (like the demo format, and like ``bit_buffer``
+   * assumes), which spills into a file once enough data has accumulated. */
+  class byte_sink
+  {
+  public:
+    byte_sink() = default;
+
+    explicit byte_sink(std::ofstream &ofs) : ofs_(&ofs)
+    {
+    }
+
+    template<typename T>
+    void write(const T &val)
+    {
+      if constexpr (std::is_enum_v<T>) {
+        write(utils::to_underlying(val));
+      } else {
+        const auto *p = reinterpret_cast<const bit_buffer::ubyte_t *>(&val);
+        buf_.insert(buf_.end(), p, p + sizeof(T));
+        spill();
+      }
+    }
+
+    void write(const std::string &str, std::string::size_type sz)
+    {
+      const auto n = std::min(str.size(), sz);
+      buf_.insert(buf_.end(), str.cbegin(), str.cbegin() + n);
+      buf_.insert(buf_.end(), sz - n, '\0');
+      spill();
+    }
+
+    void write_bytes(const bit_buffer::data_t &data)
+    {
+      buf_.insert(buf_.end(), data.cbegin(), data.cend());
+      spill();
+    }
+
+    std::uint64_t tell() const noexcept
+    {
+      return flushed_ + buf_.size();
+    }
+
+    void flush()
+    {
+      if (ofs_ != nullptr) {
+        ofs_->write(reinterpret_cast<const char *>(buf_.data()), buf_.size());
+        flushed_ += buf_.size();
+        buf_.clear();
+      }
+    }
+
+    bit_buffer::data_t &data() noexcept
+    {
+      return buf_;
+    }
+
+  private:
+    static constexpr std::size_t spill_size = 1 << 20;
+
+    void spill()
+    {
+      if (buf_.size() >= spill_size) {
+        flush();
+      }
+    }
+
+    std::ofstream *ofs_ = nullptr;
+    bit_buffer::data_t buf_;
+    std::uint64_t flushed_ = 0;
+  };
+
+  constexpr const char *samples[] = {
+    "player/pl_step1.wav",
+    "player/pl_step2.wav",
+    "player/pl_jump1.wav",
+    "weapons/ak47-1.wav",
+    "weapons/usp1.wav",
+    "items/gunpickup2.wav"
+  };
+
+  constexpr const char *commands[] = {
+    "+attack",
+    "-attack",
+    "+duck",
+    "-duck",
+    "say gg",
+    "weapon_knife"
+  };
+
+  /* ``in_buttons.h`` */
+  constexpr std::uint16_t in_attack = 1 << 0;
+  constexpr std::uint16_t in_jump = 1 << 1;
+  constexpr std::uint16_t in_forward = 1 << 3;
+  constexpr std::uint16_t in_moveleft = 1 << 9;
+  constexpr std::uint16_t in_moveright = 1 << 10;
+
+  constexpr float pi = 3.14159265f;
+  constexpr float ground_z = 36.0f;
+  constexpr float view_height = 17.0f;
+
+  /* Offset of ``dir_offset`` within the header. */
+  constexpr std::uint64_t dir_offset_pos = DEMO_CONST(demo, header_size) - sizeof(std::int32_t);
+} // namespace
+
+demo_generator::demo_generator(const generator_options &opts)
+  : opts_(opts),
+    rng_(opts.seed)
+{
+}
+
+template<typename Sink>
+void demo_generator::write_frame(Sink &s, demo::frame::type_e type, generated_demo &stats)
+{
+  using type_e = demo::frame::type_e;
+
+  demo::frame header;
+  header.type = type;
+  header.time = time_;
+  header.frame_no = frame_no_;
+  ++stats.frames[utils::to_underlying(type)];
+
+  switch (type) {
+    case type_e::demo_start:
+    case type_e::next_section: {
+      frames::write_frame<default_layout>(s, header);
+      break;
+    }
+
+    case type_e::console_command: {
+      demo::console_command_frame f(header);
+      f.command = commands[rng_.between(0, std::size(commands) - 1)];
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+
+    case type_e::client_data: {
+      demo::client_data_frame f(header);
+      std::copy(std::begin(origin_), std::end(origin_), f.origin);
+      f.viewangles[0] = pitch_;
+      f.viewangles[1] = yaw_;
+      f.wpn_bits = 1 << 28;
+      f.fov = 90.0f;
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+
+    case type_e::event: {
+      demo::event_frame f(header);
+      f.idx = static_cast<std::int32_t>(rng_.between(1, 30));
+      f.args.flags = 1;
+      f.args.ent_idx = 1;
+      std::copy(std::begin(origin_), std::end(origin_), f.args.origin);
+      f.args.angles[0] = pitch_;
+      f.args.angles[1] = yaw_;
+      std::copy(std::begin(velocity_), std::end(velocity_), f.args.velocity);
+      f.args.iparams[0] = static_cast<std::int32_t>(rng_.between(0, 255));
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+
+    case type_e::weapon_anim: {
+      demo::weapon_animation_frame f(header);
+      f.anim = static_cast<std::int32_t>(rng_.between(0, 6));
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+
+    case type_e::sound: {
+      demo::sound_frame f(header);
+      f.channel = static_cast<std::int32_t>(rng_.between(0, 7));
+      f.sample = samples[rng_.between(0, std::size(samples) - 1)];
+      f.sample_size = static_cast<std::int32_t>(f.sample.size());
+      f.attenuation = 0.8f;
+      f.volume = 1.0f;
+      f.pitch = 100;
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+
+    case type_e::demo_buffer: {
+      demo::demo_buffer_frame f(header);
+      f.buff_len = static_cast<std::int32_t>(rng_.between(8, 64));
+      f.buff.resize(f.buff_len);
+      for (auto &c : f.buff) {
+        c = static_cast<char>(rng_.next());
+      }
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+
+    /* Game data (types: 0, 1) */
+    default: {
+      demo::game_data_frame f(header);
+      const float dt = 1.0f / opts_.fps;
+      auto &rp = f.demo_info.ref_params;
+      auto &uc = f.demo_info.user_cmd;
+      auto &mv = f.demo_info.move_vars;
+
+      f.demo_info.timestamp = time_;
+
+      rp.vieworg[0] = origin_[0];
+      rp.vieworg[1] = origin_[1];
+      rp.vieworg[2] = origin_[2] + view_height;
+      rp.viewangles[0] = pitch_;
+      rp.viewangles[1] = yaw_;
+      rp.forward[0] = std::cos(yaw_ * pi / 180.0f);
+      rp.forward[1] = std::sin(yaw_ * pi / 180.0f);
+      rp.right[0] = rp.forward[1];
+      rp.right[1] = -rp.forward[0];
+      rp.up[2] = 1.0f;
+      rp.frame_time = dt;
+      rp.time = time_;
+      rp.onground = onground_ ? 1 : 0;
+      std::copy(std::begin(velocity_), std::end(velocity_), rp.simvel);
+      std::copy(std::begin(origin_), std::end(origin_), rp.simorg);
+      rp.viewheight[2] = view_height;
+      rp.cl_viewangles[0] = pitch_;
+      rp.cl_viewangles[1] = yaw_;
+      rp.health = 100;
+      rp.viewsize = 120.0f;
+      rp.max_clients = 32;
+      rp.viewentity = 1;
+      rp.max_entities = 900;
+      rp.demo_playback = 0;
+      rp.hardware = 1;
+      rp.viewport[2] = 1024;
+      rp.viewport[3] = 768;
+
+      uc.lerp_msec = 100;
+      uc.msec = static_cast<std::uint8_t>(std::lround(dt * 1000.0f));
+      uc.viewangles[0] = pitch_;
+      uc.viewangles[1] = yaw_;
+      uc.forwardmove = 400.0f;
+      uc.sidemove = rng_.chance(0.5f) ? 400.0f : -400.0f;
+      uc.buttons = in_forward | (uc.sidemove > 0.0f ? in_moveright : in_moveleft);
+      if (!onground_ && velocity_[2] > 0.0f) {
+        uc.buttons |= in_jump;
+      }
+      if (rng_.chance(0.05f)) {
+        uc.buttons |= in_attack;
+      }
+      uc.lightlevel = 64;
+
+      mv.gravity = 800.0f;
+      mv.stopspeed = 100.0f;
+      mv.maxspeed = 320.0f;
+      mv.spec_max_speed = 500.0f;
+      mv.accelerate = 10.0f;
+      mv.air_accelerate = 10.0f;
+      mv.water_accelerate = 10.0f;
+      mv.friction = 4.0f;
+      mv.edge_friction = 2.0f;
+      mv.water_friction = 1.0f;
+      mv.ent_gravity = 1.0f;
+      mv.bounce = 1.0f;
+      mv.step_size = 18.0f;
+      mv.max_velocity = 2000.0f;
+      mv.z_max = 4096.0f;
+      mv.footsteps = 1;
+      mv.sky_name = "desert";
+      mv.roll_speed = 200.0f;
+
+      f.inc_sequence = sequence_;
+      f.inc_acknowledged = sequence_ - 1;
+      f.out_sequence = sequence_;
+      ++sequence_;
+
+      /* Most network messages are small, with the occasional large one. */
+      const float u = rng_.uniform();
+      f.data.resize(16 + static_cast<std::size_t>((opts_.max_message_length - 16) * u * u * u));
+      for (auto &b : f.data) {
+        b = static_cast<bit_buffer::ubyte_t>(rng_.next());
+      }
+
+      frames::write_frame<default_layout>(s, f);
+      break;
+    }
+  }
+}
+
+generated_demo demo_generator::write(const std::filesystem::path &path)
+{
+  using type_e = demo::frame::type_e;
+
+  constexpr std::uint64_t max_size = std::numeric_limits<std::int32_t>::max() - (1 << 20);
+  const auto target_size = std::min(opts_.target_size, max_size);
+  const float dt = 1.0f / opts_.fps;
+  const auto game_data = static_cast<type_e>(1);
+
+  std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+  ofs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+  byte_sink s(ofs);
+  generated_demo stats;
+
+  /* Header (``dir_offset`` is patched in once known) */
+  s.write(std::string("HLDEMO"), DEMO_CONST(demo, header_signature_size));
+  s.write(utils::to_underlying(default_layout::dem_proto));
+  s.write(utils::to_underlying(default_layout::net_proto));
+  s.write(std::string("de_synthetic"), DEMO_CONST(demo, header_mapname_size));
+  s.write(std::string("cstrike"), DEMO_CONST(demo, header_gamedir_size));
+  s.write(std::int32_t(0)); // crc
+  s.write(std::int32_t(0)); // dir_offset
+
+  demo::directory_entry entries[2];
+
+  /* Loading section */
+  entries[0].type = demo::directory_entry::type_e::loading;
+  entries[0].description = "LOADING";
+  entries[0].offset = static_cast<std::int32_t>(s.tell());
+  write_frame(s, type_e::demo_start, stats);
+  for (int i = 0; i != 3; ++i) {
+    write_frame(s, type_e::console_command, stats);
+  }
+  for (int i = 0; i != 8; ++i, ++entries[0].frames) {
+    write_frame(s, game_data, stats);
+  }
+  write_frame(s, type_e::next_section, stats);
+  entries[0].file_length = static_cast<std::int32_t>(s.tell()) - entries[0].offset;
+
+  /* Playback section: one tick per iteration */
+  entries[1].type = demo::directory_entry::type_e::playback;
+  entries[1].description = "Playback";
+  entries[1].offset = static_cast<std::int32_t>(s.tell());
+  write_frame(s, type_e::demo_start, stats);
+  while (s.tell() < target_size) {
+    /* Strafe around, jumping every now and then. */
+    yaw_ = std::fmod(yaw_ + (rng_.uniform() - 0.5f) * 8.0f + 360.0f, 360.0f);
+    pitch_ = std::clamp(pitch_ + (rng_.uniform() - 0.5f) * 2.0f, -89.0f, 89.0f);
+    if (onground_) {
+      velocity_[0] = 250.0f * std::cos(yaw_ * pi / 180.0f);
+      velocity_[1] = 250.0f * std::sin(yaw_ * pi / 180.0f);
+      if (rng_.chance(0.02f)) {
+        velocity_[2] = 268.0f;
+        onground_ = false;
+      }
+    } else {
+      velocity_[2] -= 800.0f * dt;
+    }
+    for (int i = 0; i != 3; ++i) {
+      origin_[i] += velocity_[i] * dt;
+    }
+    if (origin_[2] <= ground_z) {
+      origin_[2] = ground_z;
+      velocity_[2] = 0.0f;
+      onground_ = true;
+    }
+
+    write_frame(s, game_data, stats);
+    write_frame(s, type_e::client_data, stats);
+    if (rng_.chance(0.05f)) {
+      write_frame(s, type_e::sound, stats);
+    }
+    if (rng_.chance(0.03f)) {
+      write_frame(s, type_e::event, stats);
+    }
+    if (rng_.chance(0.01f)) {
+      write_frame(s, type_e::weapon_anim, stats);
+    }
+    if (rng_.chance(0.005f)) {
+      write_frame(s, type_e::console_command, stats);
+    }
+    if (rng_.chance(0.001f)) {
+      write_frame(s, type_e::demo_buffer, stats);
+    }
+
+    time_ += dt;
+    ++frame_no_;
+    ++entries[1].frames;
+  }
+  write_frame(s, type_e::next_section, stats);
+  entries[1].track_time = time_;
+  entries[1].file_length = static_cast<std::int32_t>(s.tell()) - entries[1].offset;
+
+  /* Directory */
+  const auto dir_offset = static_cast<std::int32_t>(s.tell());
+  s.write(static_cast<std::uint32_t>(std::size(entries)));
+  for (const auto &e : entries) {
+    s.write(e.type);
+    s.write(e.description, DEMO_CONST(demo, dir_entry_description_size));
+    s.write(e.flags);
+    s.write(e.cdtrack);
+    s.write(e.track_time);
+    s.write(e.frames);
+    s.write(e.offset);
+    s.write(e.file_length);
+  }
+  s.flush();
+  stats.size = s.tell();
+
+  ofs.seekp(dir_offset_pos);
+  ofs.write(reinterpret_cast<const char *>(&dir_offset), sizeof(dir_offset));
+  return stats;
+}
+
+bit_buffer::data_t demo_generator::frames_of(demo::frame::type_e type, std::size_t count)
+{
+  byte_sink s;
+  generated_demo stats;
+  for (std::size_t i = 0; i != count; ++i) {
+    write_frame(s, type, stats);
+    time_ += 1.0f / opts_.fps;
+    ++frame_no_;
+  }
+  return std::move(s.data());
+}
+} // namespace bench
@@ -0,0 +1,111 @@
+#pragma once
+
+/* Deterministic generator of valid, synthetic demos, so that benchmarks do not
+ * depend on real demos (which cannot be shipped with the repository). The same
+ * options always yield byte-identical output. */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "parser/demo.hpp"
+
+#include "utils/bitbuffer.hpp"
+
+namespace bench
+{
+  /* splitmix64 - unlike the standard distributions, its output does not
+   * differ between standard library implementations. */
+  class rng
+  {
+  public:
+    explicit rng(std::uint64_t seed) noexcept : state_(seed)
+    {
+    }
+
+    std::uint64_t next() noexcept
+    {
+      auto z = (state_ += 0x9E3779B97F4A7C15);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+      return z ^ (z >> 31);
+    }
+
+    /* In ``[0; 1)``. */
+    float uniform() noexcept
+    {
+      return static_cast<float>(next() >> 40) / static_cast<float>(1 << 24);
+    }
+
+    /* In ``[lo; hi]``. */
+    std::uint32_t between(std::uint32_t lo, std::uint32_t hi) noexcept
+    {
+      return lo + static_cast<std::uint32_t>(next() % (hi - lo + 1));
+    }
+
+    bool chance(float p) noexcept
+    {
+      return uniform() < p;
+    }
+
+  private:
+    std::uint64_t state_;
+  };
+
+  struct generator_options
+  {
+    std::uint64_t seed = 1;
+    std::uint64_t target_size = 16 << 20; // approximate size of the demo, in bytes
+    float fps = 100.0f;
+    std::uint32_t max_message_length = 1400; // of game data network messages
+  };
+
+  struct generated_demo
+  {
+    std::uint64_t size = 0;
+    std::array<std::uint64_t, 10> frames = {}; // indexed by frame type
+
+    std::uint64_t total_frames() const noexcept
+    {
+      std::uint64_t total = 0;
+      for (const auto n : frames) {
+        total += n;
+      }
+      return total;
+    }
+  };
+
+  class demo_generator
+  {
+  public:
+    explicit demo_generator(const generator_options &opts);
+
+    /* Writes a demo consisting of a short loading section and a playback
+     * section of (roughly) ``target_size`` bytes, with a frame mix resembling
+     * that of a client-side recording. Demos are capped just below 2 GiB, as
+     * the header and directory store offsets as 32-bit integers. */
+    generated_demo write(const std::filesystem::path &path);
+
+    /* Encodes ``count`` frames of the given type back to back (without any
+     * header or directory), for measuring per-frame-type decoding cost. */
+    bit_buffer::data_t frames_of(demo::frame::type_e type, std::size_t count);
+
+  private:
+    template<typename Sink>
+    void write_frame(Sink &s, demo::frame::type_e type, generated_demo &stats);
+
+    generator_options opts_;
+    rng rng_;
+
+    /* Simulated player state */
+    float time_ = 0.0f;
+    std::uint32_t frame_no_ = 0;
+    float origin_[3] = {0.0f, 0.0f, 36.0f};
+    float velocity_[3] = {0.0f};
+    float yaw_ = 0.0f;
+    float pitch_ = 0.0f;
+    bool onground_ = true;
+    std::int32_t sequence_ = 0;
+  };
+} // namespace bench
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 
+#include "control.hpp"
+#include "stats.hpp"
+
 class parser;
 
 namespace hldp
@@ -10,8 +14,20 @@ namespace hldp
   class api
   {
   public:
-    api(const std::filesystem::path &demopath);
+    /* Parses the demo at ``demopath``, subject to ``control`` if given (see
+     * ``parse_control::outcome`` for whether it got through all the frames). */
+    api(const std::filesystem::path &demopath, parse_control *control = nullptr);
     virtual ~api();
+
+    /* Parsing statistics of this demo; sum them up across a batch with
+     * ``parse_stats::operator+=``. All zero unless the library was built with
+     * ``HLDP_INSTRUMENT``. */
+    parse_stats stats() const;
+
+    /* Writes the part of the demo within ``[from; to]`` (in seconds of
+     * playback time) to a new demo at ``out``, without re-encoding any frames.
+     * Returns the size of the new demo. */
+    std::uint64_t cut(float from, float to, const std::filesystem::path &out) const;
   
   private:
     parser *parser_ = nullptr;
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace hldp
+{
+  /* Metadata of a single demo, as kept by ``catalog``. */
+  struct demo_summary
+  {
+    struct entry_summary
+    {
+      std::uint32_t type = 0;   // see ``demo::directory_entry::type_e``
+      float track_time = 0.0f;
+      std::int32_t frames = 0;
+    };
+
+    /* Key - a demo is reparsed whenever its size or mtime change. */
+    std::string path;
+    std::uint64_t size = 0;
+    std::int64_t mtime = 0;   // ``std::filesystem::file_time_type`` ticks
+
+    std::string map_name;
+    std::string game_dir;
+    std::int32_t dem_proto = 0;
+    std::int32_t net_proto = 0;
+    float duration = 0.0f;
+    std::vector<entry_summary> entries;
+
+    /* Indexed by frame type (0 and 1 being game data). */
+    std::array<std::uint32_t, 10> frames = {};
+    std::uint32_t decode_errors = 0;  // see ``demo::errors``
+    std::string error;                // set if the demo could not be parsed at all
+  };
+
+  /* Demo metadata of whole directory trees, persisted in a compact binary
+   * table. ``scan`` only reparses demos which are new or whose size or mtime
+   * changed since the last scan, spreading them across threads. */
+  class catalog
+  {
+  public:
+    struct scan_result
+    {
+      std::size_t unchanged = 0;
+      std::size_t parsed = 0;
+      std::size_t failed = 0;   // of ``parsed``, see ``demo_summary::error``
+      std::size_t removed = 0;
+    };
+
+    /* Loads the table at ``path``, if there is one. A table that cannot be read
+     * (e.g. written by a different version) is discarded, so that the next
+     * scan rebuilds it. */
+    explicit catalog(const std::filesystem::path &path);
+
+    /* Brings the catalog up to date with the ``.dem`` files under ``root``
+     * (recursively); demos cataloged under ``root`` which no longer exist are
+     * dropped. ``threads == 0`` uses every hardware thread. */
+    scan_result scan(const std::filesystem::path &root, unsigned threads = 0);
+
+    /* Writes the table (to a temporary file first, which then replaces it). */
+    void save() const;
+
+    /* Sorted by path. */
+    const std::vector<demo_summary> &demos() const noexcept
+    {
+      return demos_;
+    }
+
+    const demo_summary *find(const std::filesystem::path &demopath) const;
+
+  private:
+    std::filesystem::path path_;
+    std::vector<demo_summary> demos_;
+  };
+} // namespace hldp
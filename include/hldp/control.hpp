@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace hldp
+{
+  /* Bounds and watches a parse from other threads: it may be cancelled, given
+   * a deadline or a byte budget, and reports how far it got. Limits are
+   * checked between frames, and a parse that hits one stops there, keeping
+   * the frames read up to then (see ``outcome``). A control may be reused for
+   * several parses, one at a time. */
+  class parse_control
+  {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    enum class outcome_e : std::uint8_t
+    {
+      complete = 0,
+      cancelled,    // ``cancel`` was called
+      deadline,     // the deadline passed
+      byte_budget   // the parse went past ``max_bytes`` of the file
+    };
+
+    /* ``max_bytes`` of 0 puts no bound on the parse. */
+    explicit parse_control(
+      clock::time_point deadline = clock::time_point::max(),
+      std::uint64_t max_bytes = 0
+    ) noexcept
+      : deadline_(deadline),
+        max_bytes_(max_bytes)
+    {
+    }
+
+    explicit parse_control(clock::duration timeout, std::uint64_t max_bytes = 0) noexcept
+      : parse_control(clock::now() + timeout, max_bytes)
+    {
+    }
+
+    parse_control(const parse_control &) = delete;
+    parse_control &operator=(const parse_control &) = delete;
+
+    /* Makes the parse stop at the next frame boundary (or right away, if it
+     * has not gone through the frames yet). Cancellation is final. */
+    void cancel() noexcept
+    {
+      cancelled_.store(true, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const noexcept
+    {
+      return cancelled_.load(std::memory_order_relaxed);
+    }
+
+    clock::time_point deadline() const noexcept
+    {
+      return deadline_;
+    }
+
+    std::uint64_t max_bytes() const noexcept
+    {
+      return max_bytes_;
+    }
+
+    /* Offset in the file reached by the current (or last) pass over the
+     * frames, out of ``bytes_total``. It is updated every few frames, so
+     * reading it costs the parse next to nothing. */
+    std::uint64_t bytes_done() const noexcept
+    {
+      return done_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t bytes_total() const noexcept
+    {
+      return total_.load(std::memory_order_relaxed);
+    }
+
+    /* ``bytes_done`` as a fraction, in ``[0; 1]``. */
+    double progress() const noexcept
+    {
+      const auto total = bytes_total();
+      return total != 0 ? static_cast<double>(bytes_done()) / static_cast<double>(total) : 0.0;
+    }
+
+    /* How the last pass ended (``complete`` while one is running). */
+    outcome_e outcome() const noexcept
+    {
+      return outcome_.load(std::memory_order_acquire);
+    }
+
+    /* The following are called by the parser. */
+    void start(std::uint64_t total) noexcept
+    {
+      done_.store(0, std::memory_order_relaxed);
+      total_.store(total, std::memory_order_relaxed);
+      outcome_.store(outcome_e::complete, std::memory_order_relaxed);
+    }
+
+    /* Publishes ``done`` and returns whether the parse has to stop there.
+     * Looking at the clock is left out unless ``timed``, as it costs more
+     * than the rest. */
+    bool check(std::uint64_t done, bool timed) noexcept
+    {
+      done_.store(done, std::memory_order_relaxed);
+      if (cancelled()) {
+        return stop(outcome_e::cancelled);
+      }
+      if (max_bytes_ != 0 && done > max_bytes_) {
+        return stop(outcome_e::byte_budget);
+      }
+      if (timed && deadline_ != clock::time_point::max() && clock::now() >= deadline_) {
+        return stop(outcome_e::deadline);
+      }
+      return false;
+    }
+
+    void finish() noexcept
+    {
+      done_.store(bytes_total(), std::memory_order_relaxed);
+    }
+
+  private:
+    bool stop(outcome_e outcome) noexcept
+    {
+      outcome_.store(outcome, std::memory_order_release);
+      return true;
+    }
+
+    std::atomic<bool> cancelled_ = false;
+    std::atomic<std::uint64_t> done_ = 0;
+    std::atomic<std::uint64_t> total_ = 0;
+    std::atomic<outcome_e> outcome_ = outcome_e::complete;
+    clock::time_point deadline_;
+    std::uint64_t max_bytes_ = 0;
+  };
+} // namespace hldp
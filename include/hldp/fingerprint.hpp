@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace hldp
+{
+  struct fingerprint_options
+  {
+    /* Whether to hash every frame rather than samples of each entry. */
+    bool full = false;
+    std::uint32_t samples = 16;           // per directory entry
+    std::uint32_t sample_size = 4096;     // bytes
+
+    /* Granularity of ``fingerprint::prefixes``; 0 skips them (which spares
+     * reading the whole file when sampling). */
+    std::uint64_t prefix_block = 0;
+  };
+
+  /* Identifies a demo by its contents (rather than by its name or mtime), as
+   * found without parsing it. Two demos with equal fingerprints (see
+   * ``same_demo``) are copies of each other with high probability; whether
+   * that holds for sampled fingerprints depends on the samples covering the
+   * differences, if any. All hashes are XXH64. */
+  struct fingerprint
+  {
+    std::uint64_t size = 0;
+    std::uint64_t header = 0;     // of the header, save for ``dir_offset``
+    std::uint64_t directory = 0;  // 0 if the demo has no (valid) directory
+    std::uint64_t frames = 0;     // of the frames of every entry, sampled or full
+    bool full = false;
+
+    /* Hash of the first ``(i + 1) * prefix_block`` bytes for every ``i``,
+     * ``dir_offset`` counting as 0 - a demo whose recording was cut short or
+     * which was truncated later on thus shares them with its original. */
+    std::uint64_t prefix_block = 0;
+    std::vector<std::uint64_t> prefixes;
+
+    /* Whether both are the same demo, going by the fingerprints taken in the
+     * same mode. */
+    bool same_demo(const fingerprint &other) const noexcept
+    {
+      return size == other.size
+        && header == other.header
+        && directory == other.directory
+        && frames == other.frames
+        && full == other.full;
+    }
+
+    /* Whether this demo is (possibly) a truncated copy of ``original``: its
+     * prefix hashes match those of ``original`` as far as they go, and it is
+     * no larger. The bytes past the last whole block are not compared. */
+    bool prefix_of(const fingerprint &original) const noexcept
+    {
+      if (
+        prefix_block == 0
+        || prefix_block != original.prefix_block
+        || size > original.size
+        || header != original.header
+        || prefixes.size() > original.prefixes.size()
+      ) {
+        return false;
+      }
+      /* Every prefix hash covers all the preceding blocks as well. */
+      return prefixes.empty() || prefixes.back() == original.prefixes[prefixes.size() - 1];
+    }
+  };
+
+  /* Raises ``std::filesystem::filesystem_error`` if the file cannot be read. */
+  fingerprint fingerprint_demo(const std::filesystem::path &demopath, const fingerprint_options &opts = {});
+} // namespace hldp
@@ -0,0 +1,115 @@
+#ifndef HLDP_HLDP_H
+#define HLDP_HLDP_H
+
+/* C interface of the library, for bindings (e.g. Python via ``ctypes`` or
+ * ``cffi``). It is provided by the ``hldp_c`` shared library, whose ABI only
+ * changes along with ``HLDP_ABI_VERSION``: handles are opaque, structs are
+ * only ever extended at their end, and enumerators keep their values.
+ *
+ * Decoded frame data is exported column by column (see ``hldp_column``) as
+ * borrowed, strided views which numpy or Arrow can wrap without copying. A
+ * handle may be used from one thread at a time; distinct handles are
+ * independent of each other. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(HLDP_C_EXPORTS)
+#    define HLDP_C_API __declspec(dllexport)
+#  else
+#    define HLDP_C_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define HLDP_C_API __attribute__((visibility("default")))
+#else
+#  define HLDP_C_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HLDP_ABI_VERSION 1
+
+typedef struct hldp_demo hldp_demo;
+
+typedef enum hldp_status
+{
+  HLDP_OK = 0,
+  HLDP_ERROR_ARGUMENT,    /* invalid argument (e.g. a null handle) */
+  HLDP_ERROR_IO,          /* the demo could not be read */
+  HLDP_ERROR_PARSE,       /* the demo is malformed */
+  HLDP_ERROR_NOT_FOUND,   /* no such column */
+  HLDP_ERROR_INTERNAL
+} hldp_status;
+
+typedef enum hldp_dtype
+{
+  HLDP_DTYPE_U8 = 1,
+  HLDP_DTYPE_U16,
+  HLDP_DTYPE_I32,
+  HLDP_DTYPE_U32,
+  HLDP_DTYPE_U64,
+  HLDP_DTYPE_F32
+} hldp_dtype;
+
+/* A column of ``length`` rows, row ``i`` starting at ``data + i * stride``
+ * (in bytes) and consisting of ``width`` consecutive values of ``dtype``. The
+ * data is owned by the demo handle and stays valid until it is closed. */
+typedef struct hldp_column
+{
+  const void *data;
+  uint64_t length;
+  uint64_t stride;
+  uint32_t dtype;   /* see ``hldp_dtype`` */
+  uint32_t width;
+} hldp_column;
+
+typedef struct hldp_demo_info
+{
+  int32_t dem_proto;
+  int32_t net_proto;
+  float duration;
+  uint32_t entries;
+  uint64_t frames;
+  uint32_t decode_errors;
+} hldp_demo_info;
+
+HLDP_C_API uint32_t hldp_abi_version(void);
+
+/* Message describing the last error raised on the calling thread, or an empty
+ * string. It stays valid until the thread's next call into the library. */
+HLDP_C_API const char *hldp_last_error(void);
+
+/* Opens and parses the demo at ``path`` (UTF-8). With ``tolerant`` set,
+ * malformed data is skipped over rather than failing (see
+ * ``hldp_demo_info::decode_errors``). */
+HLDP_C_API hldp_status hldp_open(const char *path, int tolerant, hldp_demo **out);
+HLDP_C_API void hldp_close(hldp_demo *demo);
+
+HLDP_C_API hldp_status hldp_info(const hldp_demo *demo, hldp_demo_info *out);
+
+/* Null-terminated strings owned by the handle. */
+HLDP_C_API const char *hldp_map_name(const hldp_demo *demo);
+HLDP_C_API const char *hldp_game_dir(const hldp_demo *demo);
+
+/* Available columns, named ``<table>.<field>`` (e.g. ``client_data.origin``),
+ * with ``index`` in ``[0; hldp_column_count())``. Columns of the same table
+ * have equally many rows, one per frame of that table's type in file order,
+ * except for the ``frame`` table, which has a row for every frame. */
+HLDP_C_API uint32_t hldp_column_count(void);
+HLDP_C_API const char *hldp_column_name(uint32_t index);
+
+/* Exports a column, decoding the fields of its table on first use (only those
+ * fields are read, in a single pass over the table's frames). */
+HLDP_C_API hldp_status hldp_column_get(hldp_demo *demo, const char *name, hldp_column *out);
+
+/* Interned string of ``frame.string_id`` (e.g. console commands), or null. */
+HLDP_C_API const char *hldp_string(const hldp_demo *demo, uint32_t id);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* HLDP_HLDP_H */
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace hldp
+{
+  /* Counters describing the work done while parsing a demo. They are only
+   * gathered when the library is built with ``HLDP_INSTRUMENT`` (see
+   * ``enabled``) and are all zero otherwise. Stats of several demos can be
+   * summed up with ``+=``, e.g. to monitor a whole batch. */
+  struct parse_stats
+  {
+#ifdef HLDP_INSTRUMENT
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    struct frame_type_stats
+    {
+      std::uint64_t count = 0;
+      std::uint64_t bytes = 0;     // including the frame header
+      std::uint64_t decode_ns = 0;
+
+      frame_type_stats &operator+=(const frame_type_stats &other) noexcept
+      {
+        count += other.count;
+        bytes += other.bytes;
+        decode_ns += other.decode_ns;
+        return *this;
+      }
+    };
+
+    /* Indexed by frame type (0 and 1 being game data, the latter also counting
+     * frames of unknown types, which are decoded as game data). */
+    static constexpr std::size_t frame_type_count = 10;
+    std::array<frame_type_stats, frame_type_count> frames = {};
+
+    /* File loading */
+    std::uint64_t loads = 0;
+    std::uint64_t load_ns = 0;
+    std::uint64_t bytes_loaded = 0;
+    std::uint64_t peak_buffer_bytes = 0; // largest amount of file data held at once
+
+    /* Bit reader */
+    std::uint64_t read_bits_calls = 0;
+    std::uint64_t read_bytes_calls = 0;
+    std::uint64_t bytes_copied = 0;      // by ``read_bytes``
+
+    std::uint64_t demos = 0;
+
+    parse_stats &operator+=(const parse_stats &other) noexcept
+    {
+      for (std::size_t i = 0; i != frame_type_count; ++i) {
+        frames[i] += other.frames[i];
+      }
+      loads += other.loads;
+      load_ns += other.load_ns;
+      bytes_loaded += other.bytes_loaded;
+      peak_buffer_bytes = std::max(peak_buffer_bytes, other.peak_buffer_bytes);
+      read_bits_calls += other.read_bits_calls;
+      read_bytes_calls += other.read_bytes_calls;
+      bytes_copied += other.bytes_copied;
+      demos += other.demos;
+      return *this;
+    }
+  };
+} // namespace hldp
@@ -0,0 +1,433 @@
+#include "movement.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "../parser/demo.hpp"
+#include "../parser/frames.hpp"
+#include "../parser/reader.hpp"
+#include "../parser/schema.hpp"
+
+#include "../utils/misc.hpp"
+#include "../utils/parallel.hpp"
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(HLDP_NO_SIMD)
+#define HLDP_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace analysis
+{
+namespace
+{
+  /* Kernels process ``[b; e)`` of their output; those looking at the previous
+   * sample may read ``b - 1`` of their input. */
+
+  /* Scalar reference */
+  void speed_scalar(const float *vx, const float *vy, float *out, std::size_t b, std::size_t e)
+  {
+    for (auto i = b; i != e; ++i) {
+      out[i] = std::sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
+    }
+  }
+
+  void yaw_deltas_scalar(const float *yaw, float *out, std::size_t b, std::size_t e)
+  {
+    for (auto i = std::max<std::size_t>(b, 1); i < e; ++i) {
+      const auto d = yaw[i] - yaw[i - 1];
+      out[i] = d - 360.0f * std::nearbyint(d / 360.0f);
+    }
+  }
+
+  void acceleration_scalar(
+    const float *speed,
+    const float *frame_time,
+    float *out,
+    std::size_t b,
+    std::size_t e
+  )
+  {
+    for (auto i = std::max<std::size_t>(b, 1); i < e; ++i) {
+      out[i] = frame_time[i] > 0.0f ? (speed[i] - speed[i - 1]) / frame_time[i] : 0.0f;
+    }
+  }
+
+  void jumps_scalar(
+    const std::int32_t *onground,
+    std::vector<std::size_t> &out,
+    std::size_t b,
+    std::size_t e
+  )
+  {
+    for (auto i = std::max<std::size_t>(b, 1); i < e; ++i) {
+      if (onground[i - 1] != 0 && onground[i] == 0) {
+        out.push_back(i);
+      }
+    }
+  }
+
+#ifdef HLDP_X86_SIMD
+  /* SSE2 (part of x86-64, hence always available) */
+  void speed_sse2(const float *vx, const float *vy, float *out, std::size_t b, std::size_t e)
+  {
+    auto i = b;
+    for (; i + 4 <= e; i += 4) {
+      const auto x = _mm_loadu_ps(vx + i);
+      const auto y = _mm_loadu_ps(vy + i);
+      _mm_storeu_ps(out + i, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))));
+    }
+    speed_scalar(vx, vy, out, i, e);
+  }
+
+  /* Round to nearest (even), like ``std::nearbyint``: adding and subtracting
+   * 2^23 drops the fraction of smaller magnitudes; larger ones (and NaNs) are
+   * integral already. */
+  inline __m128 round_sse2(__m128 x)
+  {
+    const auto sign = _mm_set1_ps(-0.0f);
+    const auto magic = _mm_set1_ps(8388608.0f);
+    const auto ax = _mm_andnot_ps(sign, x);
+    const auto r = _mm_or_ps(_mm_sub_ps(_mm_add_ps(ax, magic), magic), _mm_and_ps(sign, x));
+    const auto small = _mm_cmplt_ps(ax, magic);
+    return _mm_or_ps(_mm_and_ps(small, r), _mm_andnot_ps(small, x));
+  }
+
+  void yaw_deltas_sse2(const float *yaw, float *out, std::size_t b, std::size_t e)
+  {
+    const auto full = _mm_set1_ps(360.0f);
+    auto i = std::max<std::size_t>(b, 1);
+    for (; i + 4 <= e; i += 4) {
+      const auto d = _mm_sub_ps(_mm_loadu_ps(yaw + i), _mm_loadu_ps(yaw + i - 1));
+      _mm_storeu_ps(out + i, _mm_sub_ps(d, _mm_mul_ps(full, round_sse2(_mm_div_ps(d, full)))));
+    }
+    yaw_deltas_scalar(yaw, out, i, e);
+  }
+
+  void acceleration_sse2(
+    const float *speed,
+    const float *frame_time,
+    float *out,
+    std::size_t b,
+    std::size_t e
+  )
+  {
+    auto i = std::max<std::size_t>(b, 1);
+    for (; i + 4 <= e; i += 4) {
+      const auto dt = _mm_loadu_ps(frame_time + i);
+      const auto dv = _mm_sub_ps(_mm_loadu_ps(speed + i), _mm_loadu_ps(speed + i - 1));
+      const auto valid = _mm_cmpgt_ps(dt, _mm_setzero_ps());
+      _mm_storeu_ps(out + i, _mm_and_ps(valid, _mm_div_ps(dv, dt)));
+    }
+    acceleration_scalar(speed, frame_time, out, i, e);
+  }
+
+  void jumps_sse2(
+    const std::int32_t *onground,
+    std::vector<std::size_t> &out,
+    std::size_t b,
+    std::size_t e
+  )
+  {
+    const auto zero = _mm_setzero_si128();
+    auto i = std::max<std::size_t>(b, 1);
+    for (; i + 4 <= e; i += 4) {
+      const auto cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(onground + i));
+      const auto prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(onground + i - 1));
+      const auto left = _mm_andnot_si128(_mm_cmpeq_epi32(prev, zero), _mm_cmpeq_epi32(cur, zero));
+      for (auto bits = _mm_movemask_ps(_mm_castsi128_ps(left)); bits != 0; bits &= bits - 1) {
+        out.push_back(i + __builtin_ctz(bits));
+      }
+    }
+    jumps_scalar(onground, out, i, e);
+  }
+
+  /* AVX2 (checked for at runtime) */
+  __attribute__((target("avx2")))
+  void speed_avx2(const float *vx, const float *vy, float *out, std::size_t b, std::size_t e)
+  {
+    auto i = b;
+    for (; i + 8 <= e; i += 8) {
+      const auto x = _mm256_loadu_ps(vx + i);
+      const auto y = _mm256_loadu_ps(vy + i);
+      _mm256_storeu_ps(out + i, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y))));
+    }
+    speed_scalar(vx, vy, out, i, e);
+  }
+
+  __attribute__((target("avx2")))
+  void yaw_deltas_avx2(const float *yaw, float *out, std::size_t b, std::size_t e)
+  {
+    const auto full = _mm256_set1_ps(360.0f);
+    auto i = std::max<std::size_t>(b, 1);
+    for (; i + 8 <= e; i += 8) {
+      const auto d = _mm256_sub_ps(_mm256_loadu_ps(yaw + i), _mm256_loadu_ps(yaw + i - 1));
+      const auto turns = _mm256_round_ps(
+        _mm256_div_ps(d, full),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC
+      );
+      _mm256_storeu_ps(out + i, _mm256_sub_ps(d, _mm256_mul_ps(full, turns)));
+    }
+    yaw_deltas_scalar(yaw, out, i, e);
+  }
+
+  __attribute__((target("avx2")))
+  void acceleration_avx2(
+    const float *speed,
+    const float *frame_time,
+    float *out,
+    std::size_t b,
+    std::size_t e
+  )
+  {
+    auto i = std::max<std::size_t>(b, 1);
+    for (; i + 8 <= e; i += 8) {
+      const auto dt = _mm256_loadu_ps(frame_time + i);
+      const auto dv = _mm256_sub_ps(_mm256_loadu_ps(speed + i), _mm256_loadu_ps(speed + i - 1));
+      const auto valid = _mm256_cmp_ps(dt, _mm256_setzero_ps(), _CMP_GT_OQ);
+      _mm256_storeu_ps(out + i, _mm256_and_ps(valid, _mm256_div_ps(dv, dt)));
+    }
+    acceleration_scalar(speed, frame_time, out, i, e);
+  }
+
+  __attribute__((target("avx2")))
+  void jumps_avx2(
+    const std::int32_t *onground,
+    std::vector<std::size_t> &out,
+    std::size_t b,
+    std::size_t e
+  )
+  {
+    const auto zero = _mm256_setzero_si256();
+    auto i = std::max<std::size_t>(b, 1);
+    for (; i + 8 <= e; i += 8) {
+      const auto cur = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(onground + i));
+      const auto prev = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(onground + i - 1));
+      const auto left = _mm256_andnot_si256(
+        _mm256_cmpeq_epi32(prev, zero),
+        _mm256_cmpeq_epi32(cur, zero)
+      );
+      for (auto bits = _mm256_movemask_ps(_mm256_castsi256_ps(left)); bits != 0; bits &= bits - 1) {
+        out.push_back(i + __builtin_ctz(bits));
+      }
+    }
+    jumps_scalar(onground, out, i, e);
+  }
+#endif
+
+  isa_e effective_isa(isa_e requested) noexcept
+  {
+    return std::min(requested, best_isa(), [](auto a, auto b) {
+      return utils::to_underlying(a) < utils::to_underlying(b);
+    });
+  }
+
+  void check_sizes(std::size_t expected, std::size_t actual, const char *what)
+  {
+    if (actual != expected) {
+      throw std::invalid_argument(fmt::format(
+        "{} has {} elements (expected {})",
+        what,
+        actual,
+        expected
+      ));
+    }
+  }
+
+  /* Runs ``f(b, e)`` over the chunks of ``[0; n)``. */
+  template<typename F>
+  void for_chunks(std::size_t n, const kernel_options &opts, F &&f)
+  {
+    const auto c = utils::chunks::of(n, opts.threads, opts.min_chunk);
+    utils::parallel_for(c, [&](std::size_t i) { f(c.begin(i), c.end(i)); });
+  }
+
+  std::size_t count_of(const demo &d, demo::frame::type_e type)
+  {
+    std::size_t n = 0;
+    for (const auto &index : d.frame_index) {
+      n += static_cast<std::size_t>(std::count_if(index.cbegin(), index.cend(),
+        [type](const auto &e) { return e.type == type; }));
+    }
+    return n;
+  }
+} // namespace
+
+  isa_e best_isa() noexcept
+  {
+#ifdef HLDP_X86_SIMD
+    static const auto isa = __builtin_cpu_supports("avx2") ? isa_e::avx2 : isa_e::sse2;
+    return isa;
+#else
+    return isa_e::scalar;
+#endif
+  }
+
+  view_samples extract_view(frame_reader &reader, float from, float to)
+  {
+    using cdf = demo::client_data_frame;
+
+    view_samples v;
+    const auto n = count_of(reader.get_demo(), demo::frame::type_e::client_data);
+    for (auto *column : {&v.time, &v.origin[0], &v.origin[1], &v.origin[2], &v.pitch, &v.yaw}) {
+      column->reserve(n);
+    }
+
+    reader.for_each_projected<cdf,
+      schema::field<&cdf::origin>,
+      schema::field<&cdf::viewangles>
+    >(from, to, [&](const cdf &f) {
+      v.time.push_back(f.time);
+      for (std::size_t k = 0; k != 3; ++k) {
+        v.origin[k].push_back(f.origin[k]);
+      }
+      v.pitch.push_back(f.viewangles[0]);
+      v.yaw.push_back(f.viewangles[1]);
+    });
+    return v;
+  }
+
+  motion_samples extract_motion(frame_reader &reader, float from, float to)
+  {
+    motion_samples m;
+    reader.for_each_projected<frames::gdf,
+      frames::ref_params_field<&frames::rp::frame_time>,
+      frames::ref_params_field<&frames::rp::onground>,
+      frames::ref_params_field<&frames::rp::simvel>
+    >(from, to, [&](const frames::gdf &f) {
+      const auto &rp = f.demo_info.ref_params;
+      m.time.push_back(f.time);
+      m.frame_time.push_back(rp.frame_time);
+      for (std::size_t k = 0; k != 3; ++k) {
+        m.velocity[k].push_back(rp.simvel[k]);
+      }
+      m.onground.push_back(rp.onground);
+    });
+    return m;
+  }
+
+  void horizontal_speed(
+    std::span<const float> vx,
+    std::span<const float> vy,
+    std::span<float> out,
+    const kernel_options &opts
+  )
+  {
+    check_sizes(vx.size(), vy.size(), "vy");
+    check_sizes(vx.size(), out.size(), "out");
+
+    [[maybe_unused]] const auto isa = effective_isa(opts.isa); // unused without SIMD kernels
+    for_chunks(vx.size(), opts, [&](std::size_t b, std::size_t e) {
+#ifdef HLDP_X86_SIMD
+      if (isa == isa_e::avx2) {
+        return speed_avx2(vx.data(), vy.data(), out.data(), b, e);
+      }
+      if (isa == isa_e::sse2) {
+        return speed_sse2(vx.data(), vy.data(), out.data(), b, e);
+      }
+#endif
+      speed_scalar(vx.data(), vy.data(), out.data(), b, e);
+    });
+  }
+
+  void yaw_deltas(std::span<const float> yaw, std::span<float> out, const kernel_options &opts)
+  {
+    check_sizes(yaw.size(), out.size(), "out");
+    if (!out.empty()) {
+      out[0] = 0.0f;
+    }
+
+    [[maybe_unused]] const auto isa = effective_isa(opts.isa); // unused without SIMD kernels
+    for_chunks(yaw.size(), opts, [&](std::size_t b, std::size_t e) {
+#ifdef HLDP_X86_SIMD
+      if (isa == isa_e::avx2) {
+        return yaw_deltas_avx2(yaw.data(), out.data(), b, e);
+      }
+      if (isa == isa_e::sse2) {
+        return yaw_deltas_sse2(yaw.data(), out.data(), b, e);
+      }
+#endif
+      yaw_deltas_scalar(yaw.data(), out.data(), b, e);
+    });
+  }
+
+  void acceleration(
+    std::span<const float> speed,
+    std::span<const float> frame_time,
+    std::span<float> out,
+    const kernel_options &opts
+  )
+  {
+    check_sizes(speed.size(), frame_time.size(), "frame_time");
+    check_sizes(speed.size(), out.size(), "out");
+    if (!out.empty()) {
+      out[0] = 0.0f;
+    }
+
+    [[maybe_unused]] const auto isa = effective_isa(opts.isa); // unused without SIMD kernels
+    for_chunks(speed.size(), opts, [&](std::size_t b, std::size_t e) {
+#ifdef HLDP_X86_SIMD
+      if (isa == isa_e::avx2) {
+        return acceleration_avx2(speed.data(), frame_time.data(), out.data(), b, e);
+      }
+      if (isa == isa_e::sse2) {
+        return acceleration_sse2(speed.data(), frame_time.data(), out.data(), b, e);
+      }
+#endif
+      acceleration_scalar(speed.data(), frame_time.data(), out.data(), b, e);
+    });
+  }
+
+  std::vector<std::size_t> jump_events(
+    std::span<const std::int32_t> onground,
+    const kernel_options &opts
+  )
+  {
+    [[maybe_unused]] const auto isa = effective_isa(opts.isa); // unused without SIMD kernels
+    const auto c = utils::chunks::of(onground.size(), opts.threads, opts.min_chunk);
+    std::vector<std::vector<std::size_t>> found(c.count);
+    utils::parallel_for(c, [&](std::size_t i) {
+      const auto b = c.begin(i);
+      const auto e = c.end(i);
+#ifdef HLDP_X86_SIMD
+      if (isa == isa_e::avx2) {
+        return jumps_avx2(onground.data(), found[i], b, e);
+      }
+      if (isa == isa_e::sse2) {
+        return jumps_sse2(onground.data(), found[i], b, e);
+      }
+#endif
+      jumps_scalar(onground.data(), found[i], b, e);
+    });
+
+    std::vector<std::size_t> out;
+    for (const auto &f : found) {
+      out.insert(out.end(), f.cbegin(), f.cend());
+    }
+    return out;
+  }
+
+  movement_profile profile(
+    const motion_samples &motion,
+    const view_samples &view,
+    const kernel_options &opts
+  )
+  {
+    movement_profile p;
+    p.speed.resize(motion.time.size());
+    p.acceleration.resize(motion.time.size());
+    p.yaw_deltas.resize(view.yaw.size());
+
+    horizontal_speed(motion.velocity[0], motion.velocity[1], p.speed, opts);
+    acceleration(p.speed, motion.frame_time, p.acceleration, opts);
+    yaw_deltas(view.yaw, p.yaw_deltas, opts);
+    p.jumps = jump_events(motion.onground, opts);
+    return p;
+  }
+} // namespace analysis
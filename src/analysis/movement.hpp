@@ -0,0 +1,113 @@
+#pragma once
+
+/* Movement analytics over per-field arrays (one array per field, one element
+ * per frame) extracted from a parsed demo. Each kernel has a scalar reference
+ * implementation and SSE2/AVX2 variants, selected at runtime according to the
+ * CPU (see ``best_isa``); the vectorized variants produce bit-identical
+ * results. Large inputs are split into chunks processed on several threads. */
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "../parser/reader.hpp"
+
+namespace analysis
+{
+  enum class isa_e : std::uint8_t
+  {
+    scalar = 0,
+    sse2,
+    avx2
+  };
+
+  /* The widest instruction set supported by both the build and the CPU. */
+  isa_e best_isa() noexcept;
+
+  struct kernel_options
+  {
+    isa_e isa = best_isa();       // clamped to ``best_isa()``
+    unsigned threads = 0;         // 0 uses every hardware thread
+    std::size_t min_chunk = 1 << 16;
+  };
+
+  /* Fields of ``client_data_frame``s. */
+  struct view_samples
+  {
+    std::vector<float> time;
+    std::vector<float> origin[3];
+    std::vector<float> pitch;
+    std::vector<float> yaw;
+  };
+
+  /* Fields of ``game_data_frame::demo_info.ref_params``. */
+  struct motion_samples
+  {
+    std::vector<float> time;
+    std::vector<float> frame_time;
+    std::vector<float> velocity[3];   // ``simvel``
+    std::vector<std::int32_t> onground;
+  };
+
+  /* Only the needed fields are decoded (see ``frame_reader::for_each_projected``). */
+  view_samples extract_view(
+    frame_reader &reader,
+    float from = 0.0f,
+    float to = std::numeric_limits<float>::max()
+  );
+  motion_samples extract_motion(
+    frame_reader &reader,
+    float from = 0.0f,
+    float to = std::numeric_limits<float>::max()
+  );
+
+  /* ``out[i] = sqrt(vx[i]^2 + vy[i]^2)`` */
+  void horizontal_speed(
+    std::span<const float> vx,
+    std::span<const float> vy,
+    std::span<float> out,
+    const kernel_options &opts = {}
+  );
+
+  /* ``out[i]`` is the change of ``yaw`` since the previous sample, wrapped
+   * into ``[-180; 180]`` degrees; ``out[0]`` is 0. */
+  void yaw_deltas(
+    std::span<const float> yaw,
+    std::span<float> out,
+    const kernel_options &opts = {}
+  );
+
+  /* ``out[i] = (speed[i] - speed[i - 1]) / frame_time[i]``, or 0 for the first
+   * sample and wherever ``frame_time`` is not positive. */
+  void acceleration(
+    std::span<const float> speed,
+    std::span<const float> frame_time,
+    std::span<float> out,
+    const kernel_options &opts = {}
+  );
+
+  /* Indices of the samples at which the player left the ground, i.e. where
+   * ``onground`` turns zero. */
+  std::vector<std::size_t> jump_events(
+    std::span<const std::int32_t> onground,
+    const kernel_options &opts = {}
+  );
+
+  /* All of the above, over ``motion_samples`` (and ``view_samples`` for the
+   * yaw deltas). */
+  struct movement_profile
+  {
+    std::vector<float> speed;
+    std::vector<float> acceleration;
+    std::vector<float> yaw_deltas;
+    std::vector<std::size_t> jumps;
+  };
+
+  movement_profile profile(
+    const motion_samples &motion,
+    const view_samples &view,
+    const kernel_options &opts = {}
+  );
+} // namespace analysis
@@ -0,0 +1,99 @@
+#include "spatial.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "../parser/demo.hpp"
+#include "../parser/frames.hpp"
+#include "../parser/reader.hpp"
+#include "../parser/schema.hpp"
+
+namespace analysis
+{
+namespace
+{
+  void sort_by_offset(std::vector<spatial_index::sample> &samples)
+  {
+    std::sort(samples.begin(), samples.end(), [](const auto &a, const auto &b) {
+      return a.frame.offset < b.frame.offset;
+    });
+  }
+} // namespace
+
+  spatial_index spatial_index::build(frame_reader &reader, float cell_size)
+  {
+    using cdf = demo::client_data_frame;
+
+    std::vector<sample> samples;
+    reader.for_each_projected<cdf, schema::field<&cdf::origin>>(
+      [&](const cdf &f, const demo::frame_index_entry &e) {
+        samples.push_back({{f.origin[0], f.origin[1], f.origin[2]}, source_e::origin, e});
+      }
+    );
+    reader.for_each_projected<frames::gdf, frames::ref_params_field<&frames::rp::vieworg>>(
+      [&](const frames::gdf &f, const demo::frame_index_entry &e) {
+        const auto &v = f.demo_info.ref_params.vieworg;
+        samples.push_back({{v[0], v[1], v[2]}, source_e::vieworg, e});
+      }
+    );
+    return spatial_index(std::move(samples), cell_size);
+  }
+
+  spatial_index::spatial_index(std::vector<sample> samples, float cell_size)
+    : cell_size_(cell_size),
+      samples_(std::move(samples))
+  {
+    if (!(cell_size_ > 0.0f) || !std::isfinite(cell_size_)) {
+      throw std::invalid_argument(fmt::format("cell size must be positive (got {})", cell_size_));
+    }
+    std::erase_if(samples_, [](const sample &s) {
+      return !std::isfinite(s.pos[0]) || !std::isfinite(s.pos[1]) || !std::isfinite(s.pos[2]);
+    });
+
+    std::vector<std::pair<key_t, std::size_t>> order;
+    order.reserve(samples_.size());
+    for (std::size_t i = 0; i != samples_.size(); ++i) {
+      const auto &p = samples_[i].pos;
+      order.emplace_back(key_of(coord_of(p[0]), coord_of(p[1]), coord_of(p[2])), i);
+    }
+    std::sort(order.begin(), order.end(), [this](const auto &a, const auto &b) {
+      return a.first != b.first
+        ? a.first < b.first
+        : samples_[a.second].frame.offset < samples_[b.second].frame.offset;
+    });
+
+    std::vector<sample> sorted;
+    sorted.reserve(samples_.size());
+    for (std::size_t i = 0; i != order.size(); ++i) {
+      if (i == 0 || order[i].first != order[i - 1].first) {
+        keys_.push_back(order[i].first);
+        starts_.push_back(i);
+      }
+      sorted.push_back(samples_[order[i].second]);
+    }
+    starts_.push_back(sorted.size());
+    samples_ = std::move(sorted);
+  }
+
+  std::vector<spatial_index::sample> spatial_index::in_box(const point &lo, const point &hi) const
+  {
+    std::vector<sample> out;
+    for_each_in_box(lo, hi, [&](const sample &s) { out.push_back(s); });
+    sort_by_offset(out);
+    return out;
+  }
+
+  std::vector<spatial_index::sample> spatial_index::within(const point &center, float radius) const
+  {
+    std::vector<sample> out;
+    for_each_within(center, radius, [&](const sample &s) { out.push_back(s); });
+    sort_by_offset(out);
+    return out;
+  }
+} // namespace analysis
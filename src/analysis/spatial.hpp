@@ -0,0 +1,180 @@
+#pragma once
+
+/* A uniform grid over the positions a player has been at, answering region
+ * and proximity queries by visiting just the cells overlapping the query
+ * volume. Every sample keeps the ``demo::frame_index_entry`` of its frame, so
+ * that results can be passed straight to ``frame_reader::read_at``. */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../parser/demo.hpp"
+#include "../parser/reader.hpp"
+
+namespace analysis
+{
+  using point = std::array<float, 3>;
+
+  class spatial_index
+  {
+  public:
+    enum class source_e : std::uint8_t
+    {
+      origin = 0,  // ``client_data_frame::origin``
+      vieworg      // ``game_data_frame::demo_info.ref_params.vieworg``
+    };
+
+    struct sample
+    {
+      point pos = {};
+      source_e source = source_e::origin;
+      demo::frame_index_entry frame;
+    };
+
+    /* Samples of both sources, from every frame of the reader's demo. */
+    static spatial_index build(frame_reader &reader, float cell_size = default_cell_size);
+
+    /* Samples at non-finite positions are left out. Throws
+     * ``std::invalid_argument`` unless ``cell_size`` is positive and finite. */
+    explicit spatial_index(std::vector<sample> samples, float cell_size = default_cell_size);
+
+    /* Calls ``f(const sample &)`` for every sample within the box spanned by
+     * ``lo`` and ``hi`` (inclusive), grouped by cell and in file order within
+     * each cell. */
+    template<typename F>
+    void for_each_in_box(const point &lo, const point &hi, F &&f) const
+    {
+      for_each_cell(lo, hi, [&](std::size_t b, std::size_t e) {
+        for (auto i = b; i != e; ++i) {
+          const auto &p = samples_[i].pos;
+          if (
+            p[0] >= lo[0] && p[0] <= hi[0]
+            && p[1] >= lo[1] && p[1] <= hi[1]
+            && p[2] >= lo[2] && p[2] <= hi[2]
+          ) {
+            f(samples_[i]);
+          }
+        }
+      });
+    }
+
+    /* Like ``for_each_in_box``, for samples within ``radius`` of ``center``. */
+    template<typename F>
+    void for_each_within(const point &center, float radius, F &&f) const
+    {
+      const point lo = {center[0] - radius, center[1] - radius, center[2] - radius};
+      const point hi = {center[0] + radius, center[1] + radius, center[2] + radius};
+      const auto r2 = radius * radius;
+      for_each_in_box(lo, hi, [&](const sample &s) {
+        const auto dx = s.pos[0] - center[0];
+        const auto dy = s.pos[1] - center[1];
+        const auto dz = s.pos[2] - center[2];
+        if (dx * dx + dy * dy + dz * dz <= r2) {
+          f(s);
+        }
+      });
+    }
+
+    /* Matching samples in file order (i.e. by time, within each entry). */
+    std::vector<sample> in_box(const point &lo, const point &hi) const;
+    std::vector<sample> within(const point &center, float radius) const;
+
+    std::size_t size() const noexcept
+    {
+      return samples_.size();
+    }
+
+    float cell_size() const noexcept
+    {
+      return cell_size_;
+    }
+
+    static constexpr float default_cell_size = 256.0f; // units
+
+  private:
+    using key_t = std::uint64_t;
+
+    /* Cell coordinates are packed into 21 bits each. */
+    static constexpr int coord_bits = 21;
+    static constexpr std::int64_t coord_bias = std::int64_t(1) << (coord_bits - 1);
+
+    /* Clamped (as a float, lest the cast overflow) to the packable range,
+     * NaN ending up in its lowest cell. */
+    std::int64_t coord_of(float v) const noexcept
+    {
+      constexpr auto lo = static_cast<float>(-coord_bias);
+      constexpr auto hi = static_cast<float>(coord_bias - 1);
+      const auto c = std::floor(v / cell_size_);
+      if (!(c >= lo)) {
+        return -coord_bias;
+      }
+      return static_cast<std::int64_t>(std::min(c, hi));
+    }
+
+    static key_t key_of(std::int64_t x, std::int64_t y, std::int64_t z) noexcept
+    {
+      return static_cast<key_t>(x + coord_bias) << (2 * coord_bits)
+        | static_cast<key_t>(y + coord_bias) << coord_bits
+        | static_cast<key_t>(z + coord_bias);
+    }
+
+    /* Calls ``f(b, e)`` with the sample range of every non-empty cell
+     * overlapping the box. */
+    template<typename F>
+    void for_each_cell(const point &lo, const point &hi, F &&f) const
+    {
+      if (keys_.empty() || lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2]) {
+        return;
+      }
+
+      std::int64_t c_lo[3];
+      std::int64_t c_hi[3];
+      std::uint64_t cells = 1;
+      for (std::size_t k = 0; k != 3; ++k) {
+        c_lo[k] = coord_of(lo[k]);
+        c_hi[k] = coord_of(hi[k]);
+        cells *= static_cast<std::uint64_t>(c_hi[k] - c_lo[k] + 1);
+      }
+
+      /* Huge boxes are cheaper to answer by filtering the non-empty cells. */
+      if (cells > keys_.size()) {
+        constexpr key_t mask = (key_t(1) << coord_bits) - 1;
+        for (std::size_t i = 0; i != keys_.size(); ++i) {
+          const std::int64_t c[3] = {
+            static_cast<std::int64_t>(keys_[i] >> (2 * coord_bits) & mask) - coord_bias,
+            static_cast<std::int64_t>(keys_[i] >> coord_bits & mask) - coord_bias,
+            static_cast<std::int64_t>(keys_[i] & mask) - coord_bias
+          };
+          if (
+            c[0] >= c_lo[0] && c[0] <= c_hi[0]
+            && c[1] >= c_lo[1] && c[1] <= c_hi[1]
+            && c[2] >= c_lo[2] && c[2] <= c_hi[2]
+          ) {
+            f(starts_[i], starts_[i + 1]);
+          }
+        }
+        return;
+      }
+
+      for (auto x = c_lo[0]; x <= c_hi[0]; ++x) {
+        for (auto y = c_lo[1]; y <= c_hi[1]; ++y) {
+          /* Cells along z are adjacent in key order. */
+          const auto first = std::lower_bound(keys_.cbegin(), keys_.cend(), key_of(x, y, c_lo[2]));
+          for (auto it = first; it != keys_.cend() && *it <= key_of(x, y, c_hi[2]); ++it) {
+            const auto i = static_cast<std::size_t>(it - keys_.cbegin());
+            f(starts_[i], starts_[i + 1]);
+          }
+        }
+      }
+    }
+
+    float cell_size_ = default_cell_size;
+    std::vector<sample> samples_;       // sorted by cell, then offset
+    std::vector<key_t> keys_;           // of every non-empty cell, sorted
+    std::vector<std::size_t> starts_;   // of every cell's samples, plus ``samples_.size()``
+  };
+} // namespace analysis
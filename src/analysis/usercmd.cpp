@@ -0,0 +1,342 @@
+#include "usercmd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "../parser/frames.hpp"
+#include "../parser/reader.hpp"
+
+#include "../utils/parallel.hpp"
+
+namespace analysis
+{
+namespace
+{
+  constexpr std::size_t button_count = std::tuple_size_v<decltype(usercmd_stats::buttons)>;
+  constexpr float max_histogram_bins = 1 << 24;
+
+  void check_positive(float v, const char *what)
+  {
+    if (!(v > 0.0f) || !std::isfinite(v)) {
+      throw std::invalid_argument(fmt::format("{} must be positive (got {})", what, v));
+    }
+  }
+
+  void check_options(const usercmd_options &opts)
+  {
+    check_positive(opts.angle_bin, "angle_bin");
+    check_positive(opts.angle_range, "angle_range");
+    check_positive(opts.window, "window");
+    if (!(2.0f * opts.angle_range / opts.angle_bin <= max_histogram_bins)) {
+      throw std::invalid_argument(fmt::format(
+        "angle_range / angle_bin makes for too many bins (at most {})",
+        max_histogram_bins
+      ));
+    }
+  }
+
+  /* Window of a sample at ``t``, the first one starting at ``t0``. */
+  std::optional<std::size_t> window_of(float t, float t0, const usercmd_options &opts) noexcept
+  {
+    const auto w = std::max(0.0f, (t - t0) / opts.window);
+    if (!std::isfinite(t) || !(w < static_cast<float>(opts.max_windows))) {
+      return std::nullopt;
+    }
+    return static_cast<std::size_t>(w);
+  }
+
+  float wrap_degrees(float d) noexcept
+  {
+    return d - 360.0f * std::nearbyint(d / 360.0f);
+  }
+
+  /* Button transitions close to a chunk's boundaries, whose timings can only
+   * be completed once the neighbouring chunks are known. */
+  struct edge_state
+  {
+    std::optional<float> first_press;
+    std::optional<float> last_press;
+    std::optional<float> leading_release;  // release preceding any press within the chunk
+    std::optional<float> open_press;       // press not released within the chunk
+  };
+
+  struct partial
+  {
+    usercmd_stats stats;
+    std::size_t first_window = 0;  // of ``stats.windows``
+    std::array<edge_state, button_count> edges;
+  };
+
+  histogram make_histogram(const usercmd_options &opts)
+  {
+    histogram h;
+    h.lo = -opts.angle_range;
+    h.width = opts.angle_bin;
+    h.counts.resize(static_cast<std::size_t>(std::ceil(2.0f * opts.angle_range / opts.angle_bin)));
+    return h;
+  }
+
+  partial reduce_chunk(
+    const usercmd_samples &s,
+    std::size_t b,
+    std::size_t e,
+    float t0,
+    const usercmd_options &opts
+  )
+  {
+    partial p;
+    auto &st = p.stats;
+    st.yaw_deltas = make_histogram(opts);
+    st.pitch_deltas = make_histogram(opts);
+
+    /* Times may go backwards, so windows are laid out from the chunk's
+     * earliest one on, as they would be by a sequential pass. */
+    p.first_window = opts.max_windows;
+    for (auto i = b; i != e; ++i) {
+      if (const auto wi = window_of(s.time[i], t0, opts)) {
+        p.first_window = std::min(p.first_window, *wi);
+      }
+    }
+
+    window_stats skipped;  // of the samples without a window
+    for (auto i = b; i != e; ++i) {
+      ++st.samples;
+      ++st.msec[s.msec[i]];
+
+      const auto wi = window_of(s.time[i], t0, opts);
+      if (wi && *wi - p.first_window >= st.windows.size()) {
+        st.windows.resize(*wi - p.first_window + 1);
+      }
+      auto &w = wi ? st.windows[*wi - p.first_window] : skipped;
+      ++w.samples;
+      w.msec += s.msec[i];
+      w.moving += s.forwardmove[i] != 0.0f || s.sidemove[i] != 0.0f;
+
+      if (i == 0) {
+        continue;
+      }
+
+      const auto dyaw = wrap_degrees(s.yaw[i] - s.yaw[i - 1]);
+      const auto dpitch = wrap_degrees(s.pitch[i] - s.pitch[i - 1]);
+      st.yaw_deltas.add(dyaw);
+      st.pitch_deltas.add(dpitch);
+      w.yaw_abs += std::abs(dyaw);
+      w.yaw_sq += static_cast<double>(dyaw) * dyaw;
+      w.pitch_abs += std::abs(dpitch);
+      w.pitch_sq += static_cast<double>(dpitch) * dpitch;
+
+      const unsigned now = s.buttons[i];
+      const unsigned changed = now ^ s.buttons[i - 1];
+      w.presses += static_cast<std::uint64_t>(std::popcount(changed & now));
+      const auto t = s.time[i];
+      const bool timed = std::isfinite(t);
+      for (auto bits = changed; bits != 0; bits &= bits - 1) {
+        const auto k = static_cast<std::size_t>(std::countr_zero(bits));
+        auto &bs = st.buttons[k];
+        auto &edge = p.edges[k];
+        if (now & (1u << k)) {
+          ++bs.presses;
+          if (!timed) {
+            continue;
+          }
+          if (edge.last_press) {
+            bs.interval.add(t - *edge.last_press);
+          } else {
+            edge.first_press = t;
+          }
+          edge.last_press = t;
+          edge.open_press = t;
+        } else {
+          ++bs.releases;
+          if (!timed) {
+            continue;
+          }
+          if (edge.open_press) {
+            bs.hold.add(t - *edge.open_press);
+          } else if (bs.presses == 0) {
+            edge.leading_release = t;
+          }
+          edge.open_press.reset();
+        }
+      }
+    }
+    return p;
+  }
+
+  /* Appends ``r`` (the chunk following those merged into ``l`` so far) to ``l``. */
+  void merge(partial &l, const partial &r)
+  {
+    auto &ls = l.stats;
+    const auto &rs = r.stats;
+    ls.samples += rs.samples;
+    ls.yaw_deltas += rs.yaw_deltas;
+    ls.pitch_deltas += rs.pitch_deltas;
+    for (std::size_t i = 0; i != ls.msec.size(); ++i) {
+      ls.msec[i] += rs.msec[i];
+    }
+
+    for (std::size_t k = 0; k != button_count; ++k) {
+      auto &lb = ls.buttons[k];
+      const auto &rb = rs.buttons[k];
+      auto &le = l.edges[k];
+      const auto &re = r.edges[k];
+      const bool l_empty = lb.presses == 0 && lb.releases == 0;
+      const bool r_empty = rb.presses == 0 && rb.releases == 0;
+
+      if (le.open_press && re.leading_release) {
+        lb.hold.add(*re.leading_release - *le.open_press);
+      }
+      if (le.last_press && re.first_press) {
+        lb.interval.add(*re.first_press - *le.last_press);
+      }
+      lb.presses += rb.presses;
+      lb.releases += rb.releases;
+      lb.hold += rb.hold;
+      lb.interval += rb.interval;
+
+      if (l_empty) {
+        le.leading_release = re.leading_release;
+      }
+      if (!le.first_press) {
+        le.first_press = re.first_press;
+      }
+      if (re.last_press) {
+        le.last_press = re.last_press;
+      }
+      if (!r_empty) {
+        le.open_press = re.open_press;
+      }
+    }
+
+    /* Windows of chunks usually overlap only at their boundaries, but may do
+     * so anywhere as times go backwards. */
+    if (rs.windows.empty()) {
+      return;
+    }
+    if (ls.windows.empty() || r.first_window < l.first_window) {
+      const auto shift = ls.windows.empty() ? 0 : l.first_window - r.first_window;
+      ls.windows.insert(ls.windows.begin(), shift, window_stats());
+      l.first_window = r.first_window;
+    }
+    const auto base = r.first_window - l.first_window;
+    if (base + rs.windows.size() > ls.windows.size()) {
+      ls.windows.resize(base + rs.windows.size());
+    }
+    for (std::size_t i = 0; i != rs.windows.size(); ++i) {
+      auto &w = ls.windows[base + i];
+      const auto &o = rs.windows[i];
+      w.samples += o.samples;
+      w.msec += o.msec;
+      w.moving += o.moving;
+      w.presses += o.presses;
+      w.yaw_abs += o.yaw_abs;
+      w.yaw_sq += o.yaw_sq;
+      w.pitch_abs += o.pitch_abs;
+      w.pitch_sq += o.pitch_sq;
+    }
+  }
+} // namespace
+
+  void histogram::add(float v) noexcept
+  {
+    const auto bin = std::floor((v - lo) / width);
+    if (!(bin >= 0.0f)) {
+      ++underflow;
+    } else if (bin >= static_cast<float>(counts.size())) {
+      ++overflow;
+    } else {
+      ++counts[static_cast<std::size_t>(bin)];
+    }
+  }
+
+  histogram &histogram::operator+=(const histogram &other)
+  {
+    if (counts.size() < other.counts.size()) {
+      counts.resize(other.counts.size());
+    }
+    for (std::size_t i = 0; i != other.counts.size(); ++i) {
+      counts[i] += other.counts[i];
+    }
+    underflow += other.underflow;
+    overflow += other.overflow;
+    return *this;
+  }
+
+  void timing_stats::add(float t) noexcept
+  {
+    ++count;
+    sum += t;
+    min = std::min(min, t);
+    max = std::max(max, t);
+  }
+
+  timing_stats &timing_stats::operator+=(const timing_stats &other) noexcept
+  {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    return *this;
+  }
+
+  usercmd_samples extract_usercmds(frame_reader &reader, float from, float to)
+  {
+    usercmd_samples s;
+    reader.for_each_projected<frames::gdf,
+      frames::user_cmd_field<&frames::uc::msec>,
+      frames::user_cmd_field<&frames::uc::viewangles>,
+      frames::user_cmd_field<&frames::uc::forwardmove>,
+      frames::user_cmd_field<&frames::uc::sidemove>,
+      frames::user_cmd_field<&frames::uc::buttons>
+    >(from, to, [&](const frames::gdf &f) {
+      const auto &uc = f.demo_info.user_cmd;
+      s.time.push_back(f.time);
+      s.msec.push_back(uc.msec);
+      s.pitch.push_back(uc.viewangles[0]);
+      s.yaw.push_back(uc.viewangles[1]);
+      s.forwardmove.push_back(uc.forwardmove);
+      s.sidemove.push_back(uc.sidemove);
+      s.buttons.push_back(uc.buttons);
+    });
+    return s;
+  }
+
+  usercmd_stats reduce_usercmds(const usercmd_samples &s, const usercmd_options &opts)
+  {
+    check_options(opts);
+    if (s.time.empty()) {
+      usercmd_stats st;
+      st.yaw_deltas = make_histogram(opts);
+      st.pitch_deltas = make_histogram(opts);
+      return st;
+    }
+
+    const auto first = std::find_if(s.time.cbegin(), s.time.cend(), [](float t) {
+      return std::isfinite(t);
+    });
+    const auto t0 = first != s.time.cend() ? *first : 0.0f;
+
+    const auto c = utils::chunks::of(s.time.size(), opts.threads, opts.min_chunk);
+    std::vector<partial> parts(c.count);
+    utils::parallel_for(c, [&](std::size_t i) {
+      parts[i] = reduce_chunk(s, c.begin(i), c.end(i), t0, opts);
+    });
+    for (std::size_t i = 1; i != parts.size(); ++i) {
+      merge(parts.front(), parts[i]);
+    }
+
+    auto st = std::move(parts.front().stats);
+    for (std::size_t i = 0; i != st.windows.size(); ++i) {
+      st.windows[i].start = t0 + static_cast<float>(i) * opts.window;
+    }
+    return st;
+  }
+} // namespace analysis
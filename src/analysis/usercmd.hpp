@@ -0,0 +1,114 @@
+#pragma once
+
+/* Aim and input statistics over ``game_data_frame::demo_info.user_cmd``. All of
+ * them are gathered in a single pass, over chunks of the samples reduced in
+ * parallel and merged in order afterwards. Counts come out the same as from a
+ * sequential pass, sums of floating-point values up to rounding. */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "../parser/reader.hpp"
+
+namespace analysis
+{
+  /* Fields of ``user_cmd``, one element per game data frame. */
+  struct usercmd_samples
+  {
+    std::vector<float> time;
+    std::vector<std::uint8_t> msec;
+    std::vector<float> pitch;
+    std::vector<float> yaw;
+    std::vector<float> forwardmove;
+    std::vector<float> sidemove;
+    std::vector<std::uint16_t> buttons;
+  };
+
+  usercmd_samples extract_usercmds(
+    frame_reader &reader,
+    float from = 0.0f,
+    float to = std::numeric_limits<float>::max()
+  );
+
+  /* Fixed-width bins over ``[lo; lo + width * counts.size())``. */
+  struct histogram
+  {
+    float lo = 0.0f;
+    float width = 1.0f;
+    std::vector<std::uint64_t> counts;
+    std::uint64_t underflow = 0;
+    std::uint64_t overflow = 0;
+
+    void add(float v) noexcept;
+    histogram &operator+=(const histogram &other);
+  };
+
+  struct timing_stats
+  {
+    std::uint64_t count = 0;
+    double sum = 0.0;
+    float min = std::numeric_limits<float>::infinity();
+    float max = 0.0f;
+
+    void add(float t) noexcept;
+    timing_stats &operator+=(const timing_stats &other) noexcept;
+
+    double mean() const noexcept
+    {
+      return count != 0 ? sum / static_cast<double>(count) : 0.0;
+    }
+  };
+
+  struct button_stats
+  {
+    std::uint64_t presses = 0;
+    std::uint64_t releases = 0;
+    timing_stats hold;      // from a press to the following release
+    timing_stats interval;  // from a press to the next one
+  };
+
+  /* Sums over the samples within ``[start; start + usercmd_options::window)``. */
+  struct window_stats
+  {
+    float start = 0.0f;
+    std::uint64_t samples = 0;
+    std::uint64_t msec = 0;
+    std::uint64_t moving = 0;     // samples with ``forwardmove`` or ``sidemove`` set
+    std::uint64_t presses = 0;    // of any button
+    double yaw_abs = 0.0;         // absolute yaw deltas
+    double yaw_sq = 0.0;          // squared yaw deltas
+    double pitch_abs = 0.0;
+    double pitch_sq = 0.0;
+  };
+
+  /* ``angle_bin``, ``angle_range`` and ``window`` must be positive (and
+   * finite), or ``reduce_usercmds`` throws ``std::invalid_argument``. */
+  struct usercmd_options
+  {
+    float angle_bin = 0.05f;      // degrees
+    float angle_range = 10.0f;    // histograms cover ``[-angle_range; angle_range)``
+    float window = 1.0f;          // seconds
+    std::size_t max_windows = 1 << 20;  // samples past as many windows are left out of them
+    unsigned threads = 0;         // 0 uses every hardware thread
+    std::size_t min_chunk = 1 << 15;
+  };
+
+  struct usercmd_stats
+  {
+    std::uint64_t samples = 0;
+    histogram yaw_deltas;         // wrapped into ``[-180; 180]`` degrees
+    histogram pitch_deltas;
+    std::array<std::uint64_t, 256> msec = {};
+    std::array<button_stats, 16> buttons = {};  // indexed by bit of ``user_cmd::buttons``
+    std::vector<window_stats> windows;          // consecutive, from the first sample on
+  };
+
+  /* Windows start at the first sample with a finite time. Samples whose time
+   * is not finite are left out of ``usercmd_stats::windows`` and of button
+   * timings, those going back before the first window are counted in it, and
+   * those past ``usercmd_options::max_windows`` are left out of the windows. */
+  usercmd_stats reduce_usercmds(const usercmd_samples &s, const usercmd_options &opts = {});
+} // namespace analysis
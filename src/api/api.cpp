@@ -1,14 +1,16 @@
 #include "hldp/api.hpp"
 
+#include <cstdint>
 #include <filesystem>
 #include <memory>
 
 #include "../parser/parser.hpp"
+#include "../parser/writer.hpp"
 
 namespace hldp
 {
-  api::api(const std::filesystem::path &demopath)
-    : parser_(new parser(demopath))
+  api::api(const std::filesystem::path &demopath, parse_control *control)
+    : parser_(new parser(demopath, parser::mode_e::strict, nullptr, parser::frames_e::index, control))
   {
   }
   
@@ -16,4 +18,14 @@ namespace hldp
   {
     delete parser_;
   }
+
+  parse_stats api::stats() const
+  {
+    return parser_->stats();
+  }
+
+  std::uint64_t api::cut(float from, float to, const std::filesystem::path &out) const
+  {
+    return cut_demo(*parser_, from, to, out);
+  }
 } // namespace hldp
@@ -0,0 +1,433 @@
+#include "hldp/hldp.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <ios>
+#include <new>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../parser/demo.hpp"
+#include "../parser/frames.hpp"
+#include "../parser/parser.hpp"
+#include "../parser/reader.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/misc.hpp"
+
+namespace
+{
+  /* Rows of the exported tables. Columns are strided views into these, hence
+   * they must keep a standard layout. */
+  struct client_data_row
+  {
+    float time;
+    std::uint32_t frame_no;
+    float origin[3];
+    float viewangles[3];
+    std::int32_t wpn_bits;
+    float fov;
+  };
+
+  struct game_data_row
+  {
+    float time;
+    std::uint32_t frame_no;
+    float server_time;      // ``ref_params.time``
+    float frame_time;
+    float vieworg[3];
+    float viewangles[3];
+    float simorg[3];
+    float simvel[3];
+    std::int32_t onground;
+    std::int32_t waterlevel;
+    std::int32_t health;
+    float cmd_viewangles[3];
+    float cmd_forwardmove;
+    float cmd_sidemove;
+    float cmd_upmove;
+    std::uint16_t cmd_buttons;
+    std::uint8_t cmd_msec;
+  };
+
+  enum class table_e : std::uint8_t
+  {
+    frame = 0,
+    client_data,
+    game_data,
+    count
+  };
+
+  struct column_desc
+  {
+    const char *name;
+    table_e table;
+    std::size_t offset;
+    hldp_dtype dtype;
+    std::uint32_t width;
+  };
+
+  template<typename T>
+  constexpr hldp_dtype dtype_of()
+  {
+    using value_t = std::remove_all_extents_t<T>;
+    if constexpr (std::is_enum_v<value_t>) {
+      return dtype_of<std::underlying_type_t<value_t>>();
+    } else if constexpr (std::is_same_v<value_t, float>) {
+      return HLDP_DTYPE_F32;
+    } else if constexpr (std::is_same_v<value_t, std::uint8_t>) {
+      return HLDP_DTYPE_U8;
+    } else if constexpr (std::is_same_v<value_t, std::uint16_t>) {
+      return HLDP_DTYPE_U16;
+    } else if constexpr (std::is_same_v<value_t, std::int32_t>) {
+      return HLDP_DTYPE_I32;
+    } else if constexpr (std::is_same_v<value_t, std::uint32_t>) {
+      return HLDP_DTYPE_U32;
+    } else {
+      static_assert(std::is_same_v<value_t, std::uint64_t>, "no dtype for column type");
+      return HLDP_DTYPE_U64;
+    }
+  }
+
+#define HLDP_COLUMN(table, row, member) \
+  column_desc{ \
+    #table "." #member, \
+    table_e::table, \
+    offsetof(row, member), \
+    dtype_of<decltype(row::member)>(), \
+    static_cast<std::uint32_t>(sizeof(row::member) / sizeof(std::remove_all_extents_t<decltype(row::member)>)) \
+  }
+
+  constexpr std::array columns = {
+    HLDP_COLUMN(frame, demo::frame_index_entry, type),
+    HLDP_COLUMN(frame, demo::frame_index_entry, time),
+    HLDP_COLUMN(frame, demo::frame_index_entry, frame_no),
+    HLDP_COLUMN(frame, demo::frame_index_entry, string_id),
+    HLDP_COLUMN(frame, demo::frame_index_entry, offset),
+
+    HLDP_COLUMN(client_data, client_data_row, time),
+    HLDP_COLUMN(client_data, client_data_row, frame_no),
+    HLDP_COLUMN(client_data, client_data_row, origin),
+    HLDP_COLUMN(client_data, client_data_row, viewangles),
+    HLDP_COLUMN(client_data, client_data_row, wpn_bits),
+    HLDP_COLUMN(client_data, client_data_row, fov),
+
+    HLDP_COLUMN(game_data, game_data_row, time),
+    HLDP_COLUMN(game_data, game_data_row, frame_no),
+    HLDP_COLUMN(game_data, game_data_row, server_time),
+    HLDP_COLUMN(game_data, game_data_row, frame_time),
+    HLDP_COLUMN(game_data, game_data_row, vieworg),
+    HLDP_COLUMN(game_data, game_data_row, viewangles),
+    HLDP_COLUMN(game_data, game_data_row, simorg),
+    HLDP_COLUMN(game_data, game_data_row, simvel),
+    HLDP_COLUMN(game_data, game_data_row, onground),
+    HLDP_COLUMN(game_data, game_data_row, waterlevel),
+    HLDP_COLUMN(game_data, game_data_row, health),
+    HLDP_COLUMN(game_data, game_data_row, cmd_viewangles),
+    HLDP_COLUMN(game_data, game_data_row, cmd_forwardmove),
+    HLDP_COLUMN(game_data, game_data_row, cmd_sidemove),
+    HLDP_COLUMN(game_data, game_data_row, cmd_upmove),
+    HLDP_COLUMN(game_data, game_data_row, cmd_buttons),
+    HLDP_COLUMN(game_data, game_data_row, cmd_msec)
+  };
+
+#undef HLDP_COLUMN
+
+  thread_local std::string last_error;
+
+  /* Runs ``f`` and translates any exception into a status, as none may cross
+   * the C boundary. */
+  template<typename F>
+  hldp_status guarded(F &&f) noexcept
+  {
+    try {
+      last_error.clear();
+      return f();
+    } catch (const std::filesystem::filesystem_error &e) {
+      last_error = e.what();
+      return HLDP_ERROR_IO;
+    } catch (const std::ios_base::failure &e) {
+      last_error = e.what();
+      return HLDP_ERROR_IO;
+    } catch (const parser_error &e) {
+      last_error = e.what();
+      return HLDP_ERROR_PARSE;
+    } catch (const bit_buffer_error &e) {
+      last_error = e.what();
+      return HLDP_ERROR_PARSE;
+    } catch (const std::exception &e) {
+      last_error = e.what();
+      return HLDP_ERROR_INTERNAL;
+    } catch (...) {
+      last_error = "unknown error";
+      return HLDP_ERROR_INTERNAL;
+    }
+  }
+
+  hldp_status fail(hldp_status status, const char *what)
+  {
+    last_error = what;
+    return status;
+  }
+} // namespace
+
+struct hldp_demo
+{
+  hldp_demo(const std::filesystem::path &path, parser::mode_e mode)
+    : p(path, mode, nullptr, parser::frames_e::defer)
+  {
+    p.parse(); // the only pass over the frames, keeping the data for ``load``
+  }
+
+  void load(table_e table);
+
+  parser p;
+  std::vector<demo::frame_index_entry> frames;
+  std::vector<client_data_row> client_data;
+  std::vector<game_data_row> game_data;
+  std::array<bool, utils::to_underlying(table_e::count)> loaded = {};
+};
+
+void hldp_demo::load(table_e table)
+{
+  auto &done = loaded[utils::to_underlying(table)];
+  if (done) {
+    return;
+  }
+
+  /* Tables are built aside and only kept once complete, so that a failed
+   * load can be retried. Projections go through every frame regardless of
+   * its time, so that rows line up with the ``frame`` table. */
+  const auto &d = p.get_demo();
+  switch (table) {
+    case table_e::frame: {
+      std::size_t count = 0;
+      for (const auto &index : d.frame_index) {
+        count += index.size();
+      }
+      std::vector<demo::frame_index_entry> rows;
+      rows.reserve(count);
+      for (const auto &index : d.frame_index) {
+        rows.insert(rows.end(), index.cbegin(), index.cend());
+      }
+      frames = std::move(rows);
+      break;
+    }
+
+    case table_e::client_data: {
+      using cdf = demo::client_data_frame;
+      std::vector<client_data_row> rows;
+      frame_reader r(p);
+      r.for_each_projected<cdf,
+        schema::field<&cdf::origin>,
+        schema::field<&cdf::viewangles>,
+        schema::field<&cdf::wpn_bits>,
+        schema::field<&cdf::fov>
+      >([&](const cdf &f) {
+        auto &row = rows.emplace_back();
+        row.time = f.time;
+        row.frame_no = f.frame_no;
+        std::memcpy(row.origin, f.origin, sizeof(row.origin));
+        std::memcpy(row.viewangles, f.viewangles, sizeof(row.viewangles));
+        row.wpn_bits = f.wpn_bits;
+        row.fov = f.fov;
+      });
+      client_data = std::move(rows);
+      break;
+    }
+
+    case table_e::game_data: {
+      using frames::rp;
+      using frames::uc;
+      std::vector<game_data_row> rows;
+      frame_reader r(p);
+      r.for_each_projected<frames::gdf,
+        frames::ref_params_field<&rp::time>,
+        frames::ref_params_field<&rp::frame_time>,
+        frames::ref_params_field<&rp::vieworg>,
+        frames::ref_params_field<&rp::viewangles>,
+        frames::ref_params_field<&rp::simorg>,
+        frames::ref_params_field<&rp::simvel>,
+        frames::ref_params_field<&rp::onground>,
+        frames::ref_params_field<&rp::waterlevel>,
+        frames::ref_params_field<&rp::health>,
+        frames::user_cmd_field<&uc::viewangles>,
+        frames::user_cmd_field<&uc::forwardmove>,
+        frames::user_cmd_field<&uc::sidemove>,
+        frames::user_cmd_field<&uc::upmove>,
+        frames::user_cmd_field<&uc::buttons>,
+        frames::user_cmd_field<&uc::msec>
+      >([&](const frames::gdf &f) {
+        const auto &v = f.demo_info.ref_params;
+        const auto &cmd = f.demo_info.user_cmd;
+        auto &row = rows.emplace_back();
+        row.time = f.time;
+        row.frame_no = f.frame_no;
+        row.server_time = v.time;
+        row.frame_time = v.frame_time;
+        std::memcpy(row.vieworg, v.vieworg, sizeof(row.vieworg));
+        std::memcpy(row.viewangles, v.viewangles, sizeof(row.viewangles));
+        std::memcpy(row.simorg, v.simorg, sizeof(row.simorg));
+        std::memcpy(row.simvel, v.simvel, sizeof(row.simvel));
+        row.onground = v.onground;
+        row.waterlevel = v.waterlevel;
+        row.health = v.health;
+        std::memcpy(row.cmd_viewangles, cmd.viewangles, sizeof(row.cmd_viewangles));
+        row.cmd_forwardmove = cmd.forwardmove;
+        row.cmd_sidemove = cmd.sidemove;
+        row.cmd_upmove = cmd.upmove;
+        row.cmd_buttons = cmd.buttons;
+        row.cmd_msec = cmd.msec;
+      });
+      game_data = std::move(rows);
+      break;
+    }
+
+    default: break;
+  }
+  done = true;
+}
+
+extern "C"
+{
+  uint32_t hldp_abi_version(void)
+  {
+    return HLDP_ABI_VERSION;
+  }
+
+  const char *hldp_last_error(void)
+  {
+    return last_error.c_str();
+  }
+
+  hldp_status hldp_open(const char *path, int tolerant, hldp_demo **out)
+  {
+    if (path == nullptr || out == nullptr) {
+      return fail(HLDP_ERROR_ARGUMENT, "null argument");
+    }
+    *out = nullptr;
+    return guarded([&] {
+      const std::filesystem::path p(std::u8string(reinterpret_cast<const char8_t *>(path)));
+      if (std::error_code ec; !std::filesystem::is_regular_file(p, ec)) {
+        throw std::filesystem::filesystem_error(
+          "unable to open demo", p, ec ? ec : std::make_error_code(std::errc::no_such_file_or_directory)
+        );
+      }
+      *out = new hldp_demo(p, tolerant ? parser::mode_e::tolerant : parser::mode_e::strict);
+      return HLDP_OK;
+    });
+  }
+
+  void hldp_close(hldp_demo *demo)
+  {
+    delete demo;
+  }
+
+  hldp_status hldp_info(const hldp_demo *demo, hldp_demo_info *out)
+  {
+    if (demo == nullptr || out == nullptr) {
+      return fail(HLDP_ERROR_ARGUMENT, "null argument");
+    }
+    const auto &d = demo->p.get_demo();
+    *out = {};
+    out->dem_proto = d.dem_proto;
+    out->net_proto = d.net_proto;
+    out->duration = d.duration;
+    out->entries = static_cast<uint32_t>(d.dir_entries.size());
+    for (const auto &index : d.frame_index) {
+      out->frames += index.size();
+    }
+    out->decode_errors = static_cast<uint32_t>(d.errors.size());
+    return HLDP_OK;
+  }
+
+  const char *hldp_map_name(const hldp_demo *demo)
+  {
+    return demo != nullptr ? demo->p.get_demo().map_name.c_str() : nullptr;
+  }
+
+  const char *hldp_game_dir(const hldp_demo *demo)
+  {
+    return demo != nullptr ? demo->p.get_demo().game_dir.c_str() : nullptr;
+  }
+
+  uint32_t hldp_column_count(void)
+  {
+    return static_cast<uint32_t>(columns.size());
+  }
+
+  const char *hldp_column_name(uint32_t index)
+  {
+    return index < columns.size() ? columns[index].name : nullptr;
+  }
+
+  hldp_status hldp_column_get(hldp_demo *demo, const char *name, hldp_column *out)
+  {
+    if (demo == nullptr || name == nullptr || out == nullptr) {
+      return fail(HLDP_ERROR_ARGUMENT, "null argument");
+    }
+
+    const column_desc *desc = nullptr;
+    for (const auto &c : columns) {
+      if (std::strcmp(c.name, name) == 0) {
+        desc = &c;
+        break;
+      }
+    }
+    if (desc == nullptr) {
+      return fail(HLDP_ERROR_NOT_FOUND, "no such column");
+    }
+
+    return guarded([&] {
+      demo->load(desc->table);
+
+      const void *base = nullptr;
+      std::size_t length = 0;
+      std::size_t stride = 0;
+      switch (desc->table) {
+        case table_e::frame:
+          base = demo->frames.data();
+          length = demo->frames.size();
+          stride = sizeof(demo::frame_index_entry);
+          break;
+
+        case table_e::client_data:
+          base = demo->client_data.data();
+          length = demo->client_data.size();
+          stride = sizeof(client_data_row);
+          break;
+
+        case table_e::game_data:
+          base = demo->game_data.data();
+          length = demo->game_data.size();
+          stride = sizeof(game_data_row);
+          break;
+
+        default: break;
+      }
+
+      out->data = length != 0 ? static_cast<const std::uint8_t *>(base) + desc->offset : nullptr;
+      out->length = length;
+      out->stride = stride;
+      out->dtype = desc->dtype;
+      out->width = desc->width;
+      return HLDP_OK;
+    });
+  }
+
+  const char *hldp_string(const hldp_demo *demo, uint32_t id)
+  {
+    if (demo == nullptr) {
+      return nullptr;
+    }
+    const auto &strings = *demo->p.get_demo().strings;
+    return id < strings.size() ? strings.get(id).data() : nullptr;
+  }
+} // extern "C"
@@ -0,0 +1,279 @@
+#include "hldp/catalog.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "../parser/demo.hpp"
+#include "../parser/parser.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/bitwriter.hpp"
+#include "../utils/filebuffer.hpp"
+#include "../utils/misc.hpp"
+
+namespace hldp
+{
+namespace
+{
+  /* Table layout: magic, version, demo count, then every ``demo_summary`` in
+   * declaration order. Strings are prefixed by their 16-bit length, the
+   * entries by their 16-bit count. */
+  const std::string catalog_magic("HLDPCAT\0", 8);
+  constexpr std::uint32_t catalog_version = 1;
+
+  void write_string(bit_writer &w, const std::string &str)
+  {
+    const auto len = static_cast<std::uint16_t>(std::min<std::size_t>(str.size(), UINT16_MAX));
+    w.write(len).write(str, len);
+  }
+
+  std::string read_string(bit_buffer &b)
+  {
+    return b.read_string(b.read<std::uint16_t>());
+  }
+
+  void write_summary(bit_writer &w, const demo_summary &s)
+  {
+    write_string(w, s.path);
+    w.write(s.size).write(s.mtime);
+    write_string(w, s.map_name);
+    write_string(w, s.game_dir);
+    w
+      .write(s.dem_proto)
+      .write(s.net_proto)
+      .write(s.duration)
+      .write(static_cast<std::uint16_t>(s.entries.size()));
+    for (const auto &e : s.entries) {
+      w.write(e.type).write(e.track_time).write(e.frames);
+    }
+    for (const auto n : s.frames) {
+      w.write(n);
+    }
+    w.write(s.decode_errors);
+    write_string(w, s.error);
+  }
+
+  demo_summary read_summary(bit_buffer &b)
+  {
+    demo_summary s;
+    s.path = read_string(b);
+    b.read(s.size).read(s.mtime);
+    s.map_name = read_string(b);
+    s.game_dir = read_string(b);
+    b
+      .read(s.dem_proto)
+      .read(s.net_proto)
+      .read(s.duration);
+    s.entries.resize(b.read<std::uint16_t>());
+    for (auto &e : s.entries) {
+      b.read(e.type).read(e.track_time).read(e.frames);
+    }
+    for (auto &n : s.frames) {
+      b.read(n);
+    }
+    b.read(s.decode_errors);
+    s.error = read_string(b);
+    return s;
+  }
+
+  std::string key_of(const std::filesystem::path &p)
+  {
+    return std::filesystem::absolute(p).lexically_normal().generic_string();
+  }
+
+  bool is_demo(const std::filesystem::path &p)
+  {
+    auto ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+    return ext == ".dem";
+  }
+
+  const demo_summary *lookup(const std::vector<demo_summary> &demos, const std::string &key)
+  {
+    const auto it = std::lower_bound(demos.cbegin(), demos.cend(), key,
+      [](const auto &s, const auto &k) { return s.path < k; });
+    return it != demos.cend() && it->path == key ? &*it : nullptr;
+  }
+
+  /* Header strings are padded with null bytes. */
+  std::string trimmed(const std::string &str)
+  {
+    return str.substr(0, str.find('\0'));
+  }
+
+  /* Fills in everything but the key of ``s``. */
+  void summarize(demo_summary &s)
+  {
+    try {
+      const parser p(s.path, parser::mode_e::tolerant);
+      const auto &d = p.get_demo();
+      s.map_name = trimmed(d.map_name);
+      s.game_dir = trimmed(d.game_dir);
+      s.dem_proto = d.dem_proto;
+      s.net_proto = d.net_proto;
+      s.duration = d.duration;
+      for (const auto &e : d.dir_entries) {
+        s.entries.push_back({utils::to_underlying(e.type), e.track_time, e.frames});
+      }
+      for (const auto &index : d.frame_index) {
+        for (const auto &e : index) {
+          if (const auto type = utils::to_underlying(e.type); type < s.frames.size()) {
+            ++s.frames[type];
+          }
+        }
+      }
+      s.decode_errors = static_cast<std::uint32_t>(d.errors.size());
+      if (!d.errors.empty() && d.errors.front().code == demo::decode_error::code_e::bad_header) {
+        s.error = "bad demo header";
+      }
+    } catch (const std::exception &e) {
+      s.error = e.what();
+    }
+  }
+} // namespace
+
+  catalog::catalog(const std::filesystem::path &path)
+    : path_(path)
+  {
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path_, ec)) {
+      return;
+    }
+
+    const file_buffer fb(path_);
+    auto cur = fb.cursor();
+    cur.set_error_policy(bit_buffer::error_policy::record);
+    if (
+      cur.read_string(catalog_magic.size()) != catalog_magic
+      || cur.read<std::uint32_t>() != catalog_version
+    ) {
+      return;
+    }
+
+    const auto count = cur.read<std::uint32_t>();
+    for (std::uint32_t i = 0; i != count && !cur.failed(); ++i) {
+      demos_.push_back(read_summary(cur));
+    }
+    if (cur.failed() || !std::is_sorted(demos_.cbegin(), demos_.cend(),
+      [](const auto &a, const auto &b) { return a.path < b.path; })
+    ) {
+      demos_.clear();
+    }
+  }
+
+  catalog::scan_result catalog::scan(const std::filesystem::path &root, unsigned threads)
+  {
+    namespace fs = std::filesystem;
+
+    scan_result res;
+    auto prefix = key_of(root);
+    if (prefix.empty() || prefix.back() != '/') {
+      prefix += '/';
+    }
+    const auto under_root = [&prefix](const demo_summary &s) {
+      return s.path.starts_with(prefix);
+    };
+
+    /* Only the directory walk itself touches every file. */
+    std::vector<demo_summary> found;
+    std::error_code ec;
+    for (
+      fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec), end;
+      !ec && it != end;
+      it.increment(ec)
+    ) {
+      if (!it->is_regular_file(ec) || !is_demo(it->path())) {
+        continue;
+      }
+      demo_summary s;
+      s.path = key_of(it->path());
+      s.size = it->file_size(ec);
+      s.mtime = it->last_write_time(ec).time_since_epoch().count();
+      if (!ec) {
+        found.push_back(std::move(s));
+      }
+      ec.clear();
+    }
+    std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) { return a.path < b.path; });
+
+    std::vector<std::size_t> pending;
+    std::size_t known = 0;
+    for (std::size_t i = 0; i != found.size(); ++i) {
+      auto &s = found[i];
+      const auto old = lookup(demos_, s.path);
+      known += old != nullptr;
+      if (old != nullptr && old->size == s.size && old->mtime == s.mtime) {
+        s = *old;
+        ++res.unchanged;
+      } else {
+        pending.push_back(i);
+      }
+    }
+    res.removed = static_cast<std::size_t>(std::count_if(demos_.cbegin(), demos_.cend(), under_root)) - known;
+
+    /* Summaries are independent of each other, so workers just claim the next
+     * pending demo until none are left. */
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, pending.size()));
+    std::atomic<std::size_t> next = 0;
+    const auto work = [&] {
+      for (std::size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < pending.size(); ) {
+        summarize(found[pending[i]]);
+      }
+    };
+    {
+      std::vector<std::jthread> workers;
+      for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+      }
+      work();
+    }
+    res.parsed = pending.size();
+    res.failed = static_cast<std::size_t>(std::count_if(pending.cbegin(), pending.cend(), [&](auto i) {
+      return !found[i].error.empty();
+    }));
+
+    std::erase_if(demos_, under_root);
+    demos_.insert(demos_.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    std::sort(demos_.begin(), demos_.end(), [](const auto &a, const auto &b) { return a.path < b.path; });
+    return res;
+  }
+
+  void catalog::save() const
+  {
+    bit_writer w;
+    w
+      .write(catalog_magic, catalog_magic.size())
+      .write(catalog_version)
+      .write(static_cast<std::uint32_t>(demos_.size()));
+    for (const auto &s : demos_) {
+      write_summary(w, s);
+    }
+
+    auto tmp = path_;
+    tmp += ".tmp";
+    {
+      std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+      ofs.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+      ofs.write(reinterpret_cast<const char *>(w.data().data()), w.size());
+    }
+    std::filesystem::rename(tmp, path_);
+  }
+
+  const demo_summary *catalog::find(const std::filesystem::path &demopath) const
+  {
+    return lookup(demos_, key_of(demopath));
+  }
+} // namespace hldp
@@ -0,0 +1,161 @@
+#include "hldp/fingerprint.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include "../parser/demo.hpp"
+
+#include "../utils/hash.hpp"
+#include "../utils/mappedfile.hpp"
+
+namespace hldp
+{
+namespace
+{
+  constexpr std::size_t header_size = DEMO_CONST(demo, header_size);
+  constexpr std::size_t dir_offset_pos = header_size - sizeof(std::int32_t);
+  constexpr std::size_t dir_entry_size = DEMO_CONST(demo, dir_entry_size);
+
+  /* Offsets of ``offset`` and ``file_length`` within a directory entry. */
+  constexpr std::size_t entry_offset_pos = 84;
+  constexpr std::size_t entry_length_pos = 88;
+
+  using range = std::pair<std::size_t, std::size_t>;  // [first; second)
+
+  std::int32_t load_i32(const std::uint8_t *p) noexcept
+  {
+    std::int32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  /* Hashes ``[b; e)`` of the file as if ``dir_offset`` were 0. */
+  void update_masked(utils::xxh64 &h, const std::uint8_t *data, std::size_t b, std::size_t e)
+  {
+    constexpr std::uint8_t zeros[sizeof(std::int32_t)] = {};
+    if (b < header_size && e > dir_offset_pos) {
+      const auto mb = std::max(b, dir_offset_pos);
+      const auto me = std::min(e, header_size);
+      h.update(data + b, mb - b);
+      h.update(zeros, me - mb);
+      h.update(data + me, e - me);
+    } else {
+      h.update(data + b, e - b);
+    }
+  }
+
+  /* The directory's extent and the frame ranges of its entries, or nothing
+   * if the directory is missing or implausible. */
+  bool read_directory(const mapped_file &f, range &dir, std::vector<range> &entries)
+  {
+    const auto size = f.size();
+    if (size < header_size + sizeof(std::int32_t)) {
+      return false;
+    }
+    const auto dir_offset = load_i32(f.data() + dir_offset_pos);
+    if (dir_offset < static_cast<std::int32_t>(header_size)) {
+      return false;
+    }
+
+    const auto pos = static_cast<std::size_t>(dir_offset);
+    if (pos > size - sizeof(std::int32_t)) {
+      return false;
+    }
+    const auto count = load_i32(f.data() + pos);
+    if (
+      count < DEMO_CONST(demo, min_dir_entry_count)
+      || count > DEMO_CONST(demo, max_dir_entry_count)
+      || static_cast<std::size_t>(count) * dir_entry_size > size - pos - sizeof(std::int32_t)
+    ) {
+      return false;
+    }
+
+    dir = {pos, pos + sizeof(std::int32_t) + static_cast<std::size_t>(count) * dir_entry_size};
+    for (std::int32_t i = 0; i != count; ++i) {
+      const auto *e = f.data() + pos + sizeof(std::int32_t) + static_cast<std::size_t>(i) * dir_entry_size;
+      const auto offset = load_i32(e + entry_offset_pos);
+      const auto length = load_i32(e + entry_length_pos);
+      if (offset < static_cast<std::int32_t>(header_size) || length < 0) {
+        continue;
+      }
+      /* Frames lie between the header and the directory. */
+      const auto b = std::min(static_cast<std::size_t>(offset), pos);
+      const auto e_end = std::min(b + static_cast<std::size_t>(length), pos);
+      entries.emplace_back(b, e_end);
+    }
+    return true;
+  }
+
+  void hash_samples(utils::xxh64 &h, const std::uint8_t *data, const range &r, const fingerprint_options &opts)
+  {
+    const auto len = r.second - r.first;
+    const std::uint64_t sample_size = std::max<std::uint32_t>(opts.sample_size, 1);
+    if (opts.samples < 2 || len <= opts.samples * sample_size) {
+      h.update(data + r.first, len);
+      return;
+    }
+
+    /* Evenly spaced, the first one at the start and the last one at the end. */
+    const auto span = len - sample_size;
+    for (std::uint64_t i = 0; i != opts.samples; ++i) {
+      const auto b = r.first + static_cast<std::size_t>(span * i / (opts.samples - 1));
+      h.update(data + b, sample_size);
+    }
+  }
+} // namespace
+
+  fingerprint fingerprint_demo(const std::filesystem::path &demopath, const fingerprint_options &opts)
+  {
+    const mapped_file f(
+      demopath,
+      opts.full || opts.prefix_block != 0 ? mapped_file::access_e::sequential : mapped_file::access_e::random
+    );
+    const auto *data = f.data();
+    const auto size = f.size();
+
+    fingerprint fp;
+    fp.size = size;
+    fp.full = opts.full;
+    fp.prefix_block = opts.prefix_block;
+
+    {
+      utils::xxh64 h;
+      update_masked(h, data, 0, std::min(size, header_size));
+      fp.header = h.digest();
+    }
+
+    range dir;
+    std::vector<range> entries;
+    if (read_directory(f, dir, entries)) {
+      fp.directory = utils::xxh64::of(data + dir.first, dir.second - dir.first);
+    } else if (size > header_size) {
+      /* Without a directory, there is no telling where frames end. */
+      entries.emplace_back(header_size, size);
+    }
+
+    utils::xxh64 frames;
+    for (const auto &r : entries) {
+      if (opts.full) {
+        frames.update(data + r.first, r.second - r.first);
+      } else {
+        hash_samples(frames, data, r, opts);
+      }
+    }
+    fp.frames = frames.digest();
+
+    if (opts.prefix_block != 0) {
+      utils::xxh64 h;
+      fp.prefixes.reserve(size / opts.prefix_block);
+      for (std::size_t b = 0; size - b >= opts.prefix_block; b += opts.prefix_block) {
+        update_masked(h, data, b, b + opts.prefix_block);
+        fp.prefixes.push_back(h.digest());
+      }
+    }
+    return fp;
+  }
+} // namespace hldp
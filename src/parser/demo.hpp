@@ -1,12 +1,14 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
 #include "../utils/misc.hpp"
 #include "../utils/bitbuffer.hpp"
+#include "../utils/stringtable.hpp"
 
 #define DEMO_CONST(enum, member) utils::to_underlying(enum::constants_e::member)
 
@@ -27,6 +29,14 @@ struct demo
     dir_entry_description_size = 64
   };
 
+  /* Known values of ``dem_proto`` and ``net_proto`` (see ``layout.hpp``). */
+  enum class protocol_e : std::int32_t
+  {
+    dem_5 = 5,
+    net_47 = 47,
+    net_48 = 48
+  };
+
   struct directory_entry
   {
     enum class type_e : std::uint32_t
@@ -111,7 +121,7 @@ struct demo
     std::int32_t idx = 0;
     float delay = 0.0f;
 
-    struct
+    struct args_t
     {
       std::int32_t flags = 0;
       std::int32_t ent_idx = 0;
@@ -166,11 +176,11 @@ struct demo
       max_message_length = 65536
     };
 
-    struct
+    struct demo_info_t
     {
       float timestamp = 0.0f;
 
-      struct
+      struct ref_params_t
       {
         float vieworg[3] = {0.0f};
         float viewangles[3] = {0.0f};
@@ -207,7 +217,7 @@ struct demo
         std::int32_t only_client_draw = 0;
       } ref_params;
 
-      struct
+      struct user_cmd_t
       {
         std::int16_t lerp_msec = 0;
         std::uint8_t msec = 0;
@@ -226,7 +236,7 @@ struct demo
         float impact_pos[3] = {0.0f};
       } user_cmd;
 
-      struct
+      struct move_vars_t
       {
         float gravity = 0.0f;
         float stopspeed = 0.0f;
@@ -269,11 +279,45 @@ struct demo
     bit_buffer::data_t data;
   };
 
+  /* Location of a single frame within the demo file, gathered while parsing so
+   * that frames can later be revisited without walking the whole demo. */
+  struct frame_index_entry
+  {
+    frame::type_e type = frame::type_e::demo_start;
+    float time = 0.0f;
+    std::uint32_t frame_no = 0;
+    string_table::id_t string_id = string_table::none; // in ``demo::strings``, see ``frames::interned_string``
+    bit_buffer::size_t offset = 0; // of the frame header, from the beginning of the file
+  };
+
+  /* A part of the demo that could not be decoded (only gathered when parsing
+   * in ``parser::mode_e::tolerant``). */
+  struct decode_error
+  {
+    enum class code_e : std::uint8_t
+    {
+      none = 0,
+      bad_header,     // header could not be read - nothing else was parsed
+      bad_directory,  // directory missing or invalid - entries were recovered by scanning
+      bad_frame,      // implausible frame header or segment contents
+      out_of_bounds   // frame extends past the end of the demo (truncation)
+    };
+
+    code_e code = code_e::none;
+    std::uint32_t dir = 0;            // index of the directory entry being parsed
+    bit_buffer::size_t offset = 0;    // of the offending structure, from the beginning of the file
+    bit_buffer::size_t resumed = 0;   // where parsing resumed (0 if the rest of the entry was dropped)
+  };
+
   std::int32_t dem_proto = 0;
   std::int32_t net_proto = 0;
+  std::string map_name;
   std::string game_dir;
   std::int32_t crc = 0;
   float duration = 0.0f;
   std::int32_t dir_offset = 0;
   std::vector<directory_entry> dir_entries;
+  std::vector<std::vector<frame_index_entry>> frame_index; // one per directory entry
+  std::shared_ptr<string_table> strings;                    // possibly shared with other demos
+  std::vector<decode_error> errors;
 };
@@ -0,0 +1,119 @@
+#include "follower.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "fmt/format.h"
+
+#include "demo.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/misc.hpp"
+
+namespace
+{
+  /* Offset of ``dir_offset`` within the header. */
+  constexpr std::streamoff dir_offset_pos = DEMO_CONST(demo, header_size) - sizeof(std::int32_t);
+} // namespace
+
+demo_follower::demo_follower(const std::filesystem::path &demopath, const follow_options &opts)
+  : ifs_(demopath, std::ios::binary),
+    opts_(opts)
+{
+  demo_.strings = opts_.strings ? opts_.strings : std::make_shared<string_table>();
+  if (!ifs_) {
+    throw parser_error(fmt::format("unable to open {}", demopath.string()));
+  }
+}
+
+bool demo_follower::fetch()
+{
+  fetched_ = false;
+  const auto buffered = pending_.size() - head_;
+  if (header_read_ && opts_.max_read != 0 && buffered >= opts_.max_read && !starved_) {
+    return true;
+  }
+
+  /* Reaching the end of the file on the previous poll leaves the stream
+   * failed, and so does reading past it while the recorder is mid-write. */
+  ifs_.clear();
+  const auto size = static_cast<bit_buffer::size_t>(ifs_.seekg(0, std::ios::end).tellg());
+  auto amt = size > read_ ? size - read_ : 0;
+  if (opts_.max_read != 0) {
+    amt = std::min(amt, opts_.max_read);
+  }
+  if (amt != 0) {
+    /* Drop the frames decoded so far, which costs no more than reading the
+     * bytes still buffered did. */
+    pending_.erase(pending_.begin(), pending_.begin() + head_);
+    pending_offset_ += head_;
+    head_ = 0;
+
+    const auto old = pending_.size();
+    pending_.resize(old + amt);
+    ifs_.seekg(read_);
+    ifs_.read(reinterpret_cast<char *>(pending_.data() + old), amt);
+    read_ += amt;
+    fetched_ = true;
+  }
+
+  if (!header_read_) {
+    if (pending_.size() < DEMO_CONST(demo, header_size)) {
+      return false;
+    }
+    read_header();
+  } else if (demo_.dir_offset == 0) {
+    /* The recorder patches ``dir_offset`` in once it has written the directory. */
+    char buf[sizeof(std::int32_t)] = {};
+    ifs_.seekg(dir_offset_pos);
+    if (ifs_.read(buf, sizeof(buf))) {
+      std::memcpy(&demo_.dir_offset, buf, sizeof(buf));
+    }
+  }
+  return true;
+}
+
+void demo_follower::read_header()
+{
+  bit_buffer bb(pending_);
+  if (bb.read<std::string>() != "HLDEMO") {
+    throw parser_error("bad demo signature");
+  }
+
+  bb
+    .seek_bytes(DEMO_CONST(demo, header_signature_size))
+    .read(demo_.dem_proto)
+    .read(demo_.net_proto)
+    .read(demo_.map_name, DEMO_CONST(demo, header_mapname_size))
+    .read(demo_.game_dir, DEMO_CONST(demo, header_gamedir_size))
+    .read(demo_.crc)
+    .read(demo_.dir_offset);
+
+  head_ = DEMO_CONST(demo, header_size);
+  header_read_ = true;
+}
+
+bool demo_follower::at_directory(const bit_buffer::ubyte_t *data) const
+{
+  std::uint32_t count = 0;
+  demo::directory_entry e;
+  bit_buffer bb(data, directory_probe_size);
+  bb
+    .read(count)
+    .read(e.type)
+    .seek_bytes(DEMO_CONST(demo, dir_entry_description_size), bit_buffer::seek_dir::cur)
+    .read(e.flags)
+    .read(e.cdtrack)
+    .read(e.track_time)
+    .read(e.frames)
+    .read(e.offset);
+  return
+    count >= DEMO_CONST(demo, min_dir_entry_count)
+    && count <= DEMO_CONST(demo, max_dir_entry_count)
+    && e.type == demo::directory_entry::type_e::loading
+    && e.offset == demo_.dir_entries.front().offset;
+}
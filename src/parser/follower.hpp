@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <memory>
+
+#include "fmt/format.h"
+
+#include "demo.hpp"
+#include "frames.hpp"
+#include "layout.hpp"
+#include "parser.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/stringtable.hpp"
+
+struct follow_options
+{
+  bit_buffer::size_t max_read = 0;  // bytes read per poll at most (0 reads whatever was appended)
+  bool keep_index = true;           // whether to fill in ``demo::frame_index``
+  std::shared_ptr<string_table> strings;  // see ``parser::parser``
+};
+
+/* Parses a demo that is still being recorded. Each ``poll`` reads whatever has
+ * been appended to the file since the previous one and decodes the frames
+ * completed by now, resuming from the first incomplete frame; only the bytes
+ * of that frame are kept between polls. The directory is not needed - just as
+ * with ``parser::mode_e::tolerant``, entries are rebuilt from the frames (the
+ * first one being loading, and each ``next_section`` frame starting a new
+ * playback entry), and the frame index is filled in alongside.
+ *
+ * With ``follow_options::max_read`` set, the follower doubles as a lazy
+ * sequential reader over complete demos, whose memory use is bounded by that
+ * amount (plus the largest frame) rather than by the size of the demo. */
+class demo_follower
+{
+public:
+  explicit demo_follower(const std::filesystem::path &demopath, const follow_options &opts = {});
+
+  /* Passes up to ``max_frames`` newly completed frames to ``vis`` (see
+   * ``frames::read_frame``) and returns their count. Raises a ``parser_error``
+   * on malformed data. */
+  template<typename Visitor>
+  std::size_t poll(Visitor &&vis, std::size_t max_frames = std::numeric_limits<std::size_t>::max())
+  {
+    if (!fetch()) {
+      stalled_ = !fetched_;
+      return 0;
+    }
+    const auto count = with_frame_layout(demo_, [&]<typename Layout>() {
+      return decode<Layout>(vis, max_frames);
+    });
+    stalled_ = count == 0 && !fetched_;
+    return count;
+  }
+
+  /* True once the recording has ended, i.e. the header's ``dir_offset`` has
+   * been written and every frame preceding the directory was decoded. */
+  bool finished() const noexcept
+  {
+    return demo_.dir_offset > 0 && offset() >= static_cast<bit_buffer::size_t>(demo_.dir_offset);
+  }
+
+  /* True if the last poll neither read nor decoded anything, i.e. there is
+   * nothing more to be had until the file grows. */
+  bool stalled() const noexcept
+  {
+    return stalled_;
+  }
+
+  const demo &get_demo() const noexcept
+  {
+    return demo_;
+  }
+
+  /* File offset of the first frame not yet decoded. */
+  bit_buffer::size_t offset() const noexcept
+  {
+    return pending_offset_ + head_;
+  }
+
+private:
+  /* Reads newly appended data (as needed). Returns false while the header is
+   * incomplete. */
+  bool fetch();
+  void read_header();
+
+  /* Size of the directory's entry count and first entry, see ``at_directory``. */
+  static constexpr bit_buffer::size_t directory_probe_size =
+    sizeof(std::uint32_t) + DEMO_CONST(demo, dir_entry_size);
+
+  /* Whether ``data`` (of ``directory_probe_size`` bytes) starts the directory. */
+  bool at_directory(const bit_buffer::ubyte_t *data) const;
+
+  template<typename Layout, typename Visitor>
+  std::size_t decode(Visitor &vis, std::size_t max_frames);
+
+  std::ifstream ifs_;
+  follow_options opts_;
+  bit_buffer::data_t pending_;            // file data from ``pending_offset_`` on
+  bit_buffer::size_t pending_offset_ = 0;
+  bit_buffer::size_t head_ = 0;           // of the first frame not yet decoded, within ``pending_``
+  bit_buffer::size_t read_ = 0;           // bytes of the file read so far
+  demo demo_;
+  bool header_read_ = false;
+  bool entry_open_ = false;
+  bool starved_ = false;                  // the last decode ran out of data
+  bool fetched_ = false;                  // the last fetch read anything
+  bool stalled_ = false;
+};
+
+template<typename Layout, typename Visitor>
+std::size_t demo_follower::decode(Visitor &vis, std::size_t max_frames)
+{
+  using code_e = demo::decode_error::code_e;
+
+  /* Frames end where the directory begins, once its offset is known. */
+  auto limit = pending_.size() - head_;
+  if (demo_.dir_offset > 0) {
+    const auto dir_offset = static_cast<bit_buffer::size_t>(demo_.dir_offset);
+    limit = dir_offset > offset() ? std::min(limit, dir_offset - offset()) : 0;
+  }
+
+  const auto *data = pending_.data() + head_;
+  bit_buffer cur(data, limit);
+  cur.set_error_policy(bit_buffer::error_policy::record);
+  std::size_t count = 0;
+  bit_buffer::size_t pos = 0;
+  starved_ = false;
+  while (pos < limit && count < max_frames) {
+    const auto offset = this->offset() + pos;
+
+    /* The recorder writes the directory right after the last playback entry,
+     * but patches in ``dir_offset`` only afterwards. */
+    if (
+      !entry_open_
+      && !demo_.dir_entries.empty()
+      && demo_.dir_entries.back().type == demo::directory_entry::type_e::playback
+    ) {
+      if (limit - pos < directory_probe_size) {
+        starved_ = true;
+        break;
+      }
+      if (at_directory(data + pos)) {
+        demo_.dir_offset = static_cast<std::int32_t>(offset);
+        break;
+      }
+    }
+
+    if (!entry_open_) {
+      demo::directory_entry e;
+      e.type = demo_.dir_entries.empty()
+        ? demo::directory_entry::type_e::loading
+        : demo::directory_entry::type_e::playback;
+      e.offset = static_cast<std::int32_t>(offset);
+      demo_.dir_entries.push_back(std::move(e));
+      demo_.frame_index.emplace_back();
+      entry_open_ = true;
+    }
+    auto &e = demo_.dir_entries.back();
+
+    const auto res = frames::try_read_frame<Layout>(cur, [&](const auto &f) {
+      if (opts_.keep_index) {
+        demo_.frame_index.back().push_back({
+          f.type, f.time, f.frame_no, frames::intern(*demo_.strings, f), offset
+        });
+      }
+      ++e.frames;
+      e.track_time = f.time;
+      ++count;
+      vis(f);
+    });
+    if (!res) {
+      if (res.error() == code_e::out_of_bounds) {
+        starved_ = true; // not written (or read) completely yet
+        break;
+      }
+      throw parser_error(fmt::format("malformed frame at offset {}", offset));
+    }
+
+    pos = cur.tell();
+    e.file_length = static_cast<std::int32_t>(this->offset() + pos - e.offset);
+    if (e.type == demo::directory_entry::type_e::playback) {
+      demo_.duration = e.track_time;
+    }
+    entry_open_ = *res;
+  }
+
+  head_ += pos;
+  return count;
+}
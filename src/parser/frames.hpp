@@ -0,0 +1,645 @@
+#pragma once
+
+/* Decoders for individual frame segments. They are templated on the frame
+ * layout of the demo's protocol version (see ``layout.hpp``) and on the stream
+ * type, so that they may be used with both a ``file_buffer`` (sequential
+ * parsing) and a standalone ``bit_buffer`` cursor (e.g. ``frame_reader``).
+ *
+ * Every fixed-size segment is described exactly once, as a ``schema::segment``
+ * in ``segments``; its decoder, size check and projections are derived from
+ * that description. */
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "demo.hpp"
+#include "layout.hpp"
+#include "schema.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/misc.hpp"
+#include "../utils/stringtable.hpp"
+
+namespace frames
+{
+  using gdf = demo::game_data_frame;
+  using di = gdf::demo_info_t;
+  using rp = di::ref_params_t;
+  using uc = di::user_cmd_t;
+  using mv = di::move_vars_t;
+
+  /* Shorthands for fields nested within ``game_data_frame::demo_info``. */
+  template<auto... Path>
+  using demo_info_field = schema::field<&gdf::demo_info, Path...>;
+
+  template<auto... Path>
+  using ref_params_field = demo_info_field<&di::ref_params, Path...>;
+
+  template<auto... Path>
+  using user_cmd_field = demo_info_field<&di::user_cmd, Path...>;
+
+  template<auto... Path>
+  using move_vars_field = demo_info_field<&di::move_vars, Path...>;
+
+  template<typename Layout>
+  struct segments
+  {
+    using console_command = schema::segment<demo::console_command_frame,
+      schema::basic_field<
+        schema::fixed_string<Layout::console_command_size>,
+        &demo::console_command_frame::command
+      >
+    >;
+
+    using client_data = schema::segment<demo::client_data_frame,
+      schema::field<&demo::client_data_frame::origin>,
+      schema::field<&demo::client_data_frame::viewangles>,
+      schema::field<&demo::client_data_frame::wpn_bits>,
+      schema::field<&demo::client_data_frame::fov>
+    >;
+
+    using event = schema::segment<demo::event_frame,
+      schema::field<&demo::event_frame::flags>,
+      schema::field<&demo::event_frame::idx>,
+      schema::field<&demo::event_frame::delay>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::flags>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::ent_idx>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::origin>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::angles>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::velocity>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::ducking>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::fparams>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::iparams>,
+      schema::field<&demo::event_frame::args, &demo::event_frame::args_t::bparams>
+    >;
+
+    using weapon_animation = schema::segment<demo::weapon_animation_frame,
+      schema::field<&demo::weapon_animation_frame::anim>,
+      schema::field<&demo::weapon_animation_frame::body>
+    >;
+
+    /* The sound segment is split by the variable-length sample name. */
+    using sound_head = schema::segment<demo::sound_frame,
+      schema::field<&demo::sound_frame::channel>,
+      schema::field<&demo::sound_frame::sample_size>
+    >;
+
+    using sound_tail = schema::segment<demo::sound_frame,
+      schema::field<&demo::sound_frame::attenuation>,
+      schema::field<&demo::sound_frame::volume>,
+      schema::field<&demo::sound_frame::flags>,
+      schema::field<&demo::sound_frame::pitch>
+    >;
+
+    using demo_buffer = schema::segment<demo::demo_buffer_frame,
+      schema::field<&demo::demo_buffer_frame::buff_len>
+    >;
+
+    /* Demo info and sequence info; the (variable-length) network message that
+     * follows is not part of the segment. */
+    using game_data = schema::segment<demo::game_data_frame,
+      demo_info_field<&di::timestamp>,
+      ref_params_field<&rp::vieworg>,
+      ref_params_field<&rp::viewangles>,
+      ref_params_field<&rp::forward>,
+      ref_params_field<&rp::right>,
+      ref_params_field<&rp::up>,
+      ref_params_field<&rp::frame_time>,
+      ref_params_field<&rp::time>,
+      ref_params_field<&rp::intermission>,
+      ref_params_field<&rp::paused>,
+      ref_params_field<&rp::spectator>,
+      ref_params_field<&rp::onground>,
+      ref_params_field<&rp::waterlevel>,
+      ref_params_field<&rp::simvel>,
+      ref_params_field<&rp::simorg>,
+      ref_params_field<&rp::viewheight>,
+      ref_params_field<&rp::ideal_pitch>,
+      ref_params_field<&rp::cl_viewangles>,
+      ref_params_field<&rp::health>,
+      ref_params_field<&rp::crosshairangle>,
+      ref_params_field<&rp::viewsize>,
+      ref_params_field<&rp::punchangle>,
+      ref_params_field<&rp::max_clients>,
+      ref_params_field<&rp::viewentity>,
+      ref_params_field<&rp::playernum>,
+      ref_params_field<&rp::max_entities>,
+      ref_params_field<&rp::demo_playback>,
+      ref_params_field<&rp::hardware>,
+      ref_params_field<&rp::smoothing>,
+      ref_params_field<&rp::ptr_cmd>,
+      ref_params_field<&rp::ptr_movevars>,
+      ref_params_field<&rp::viewport>,
+      ref_params_field<&rp::next_view>,
+      ref_params_field<&rp::only_client_draw>,
+      user_cmd_field<&uc::lerp_msec>,
+      user_cmd_field<&uc::msec>,
+      user_cmd_field<&uc::pad1>,
+      user_cmd_field<&uc::viewangles>,
+      user_cmd_field<&uc::forwardmove>,
+      user_cmd_field<&uc::sidemove>,
+      user_cmd_field<&uc::upmove>,
+      user_cmd_field<&uc::lightlevel>,
+      user_cmd_field<&uc::pad2>,
+      user_cmd_field<&uc::buttons>,
+      user_cmd_field<&uc::impulse>,
+      user_cmd_field<&uc::weapon_select>,
+      user_cmd_field<&uc::pad3>,
+      user_cmd_field<&uc::impact_idx>,
+      user_cmd_field<&uc::impact_pos>,
+      move_vars_field<&mv::gravity>,
+      move_vars_field<&mv::stopspeed>,
+      move_vars_field<&mv::maxspeed>,
+      move_vars_field<&mv::spec_max_speed>,
+      move_vars_field<&mv::accelerate>,
+      move_vars_field<&mv::air_accelerate>,
+      move_vars_field<&mv::water_accelerate>,
+      move_vars_field<&mv::friction>,
+      move_vars_field<&mv::edge_friction>,
+      move_vars_field<&mv::water_friction>,
+      move_vars_field<&mv::ent_gravity>,
+      move_vars_field<&mv::bounce>,
+      move_vars_field<&mv::step_size>,
+      move_vars_field<&mv::max_velocity>,
+      move_vars_field<&mv::z_max>,
+      move_vars_field<&mv::wave_height>,
+      move_vars_field<&mv::footsteps>,
+      schema::basic_field<
+        schema::fixed_string<Layout::skyname_size>,
+        &gdf::demo_info, &di::move_vars, &mv::sky_name
+      >,
+      move_vars_field<&mv::roll_angle>,
+      move_vars_field<&mv::roll_speed>,
+      move_vars_field<&mv::sky_color>,
+      move_vars_field<&mv::sky_vec>,
+      demo_info_field<&di::view>,
+      demo_info_field<&di::viewmodel>,
+      schema::field<&gdf::inc_sequence>,
+      schema::field<&gdf::inc_acknowledged>,
+      schema::field<&gdf::inc_rel_acknowledged>,
+      schema::field<&gdf::inc_rel_sequence>,
+      schema::field<&gdf::out_sequence>,
+      schema::field<&gdf::rel_sequence>,
+      schema::field<&gdf::last_rel_sequence>
+    >;
+
+    static_assert(console_command::size == Layout::console_command_size);
+    static_assert(client_data::size == Layout::client_data_size);
+    static_assert(event::size == Layout::event_size);
+    static_assert(weapon_animation::size == Layout::weapon_animation_size);
+    static_assert(sound_head::size == Layout::sound_head_size);
+    static_assert(sound_tail::size == Layout::sound_tail_size);
+    static_assert(demo_buffer::size == Layout::demo_buffer_size);
+    static_assert(game_data::size == Layout::demoinfo_size + Layout::sequence_info_size);
+  };
+
+  /* Maps a frame struct to its (fixed-size) segment, for use with projections. */
+  template<typename Layout, typename Frame>
+  struct segment_of;
+
+  template<typename Layout>
+  struct segment_of<Layout, demo::console_command_frame>
+  {
+    using type = typename segments<Layout>::console_command;
+  };
+
+  template<typename Layout>
+  struct segment_of<Layout, demo::client_data_frame>
+  {
+    using type = typename segments<Layout>::client_data;
+  };
+
+  template<typename Layout>
+  struct segment_of<Layout, demo::event_frame>
+  {
+    using type = typename segments<Layout>::event;
+  };
+
+  template<typename Layout>
+  struct segment_of<Layout, demo::weapon_animation_frame>
+  {
+    using type = typename segments<Layout>::weapon_animation;
+  };
+
+  template<typename Layout>
+  struct segment_of<Layout, demo::game_data_frame>
+  {
+    using type = typename segments<Layout>::game_data;
+  };
+
+  template<typename Layout, typename Frame>
+  using segment_of_t = typename segment_of<Layout, Frame>::type;
+
+  /* Whether a frame of type ``type`` is decoded into a ``Frame``. */
+  template<typename Frame>
+  constexpr bool is_frame_of(demo::frame::type_e type) noexcept
+  {
+    using type_e = demo::frame::type_e;
+    if constexpr (std::is_same_v<Frame, demo::console_command_frame>) {
+      return type == type_e::console_command;
+    } else if constexpr (std::is_same_v<Frame, demo::client_data_frame>) {
+      return type == type_e::client_data;
+    } else if constexpr (std::is_same_v<Frame, demo::event_frame>) {
+      return type == type_e::event;
+    } else if constexpr (std::is_same_v<Frame, demo::weapon_animation_frame>) {
+      return type == type_e::weapon_anim;
+    } else if constexpr (std::is_same_v<Frame, demo::sound_frame>) {
+      return type == type_e::sound;
+    } else if constexpr (std::is_same_v<Frame, demo::demo_buffer_frame>) {
+      return type == type_e::demo_buffer;
+    } else if constexpr (std::is_same_v<Frame, demo::game_data_frame>) {
+      return utils::to_underlying(type) < utils::to_underlying(type_e::demo_start);
+    } else {
+      return true;
+    }
+  }
+
+  template<typename Stream>
+  void read_header(Stream &s, demo::frame &f)
+  {
+    s
+      .read(f.type)
+      .read(f.time)
+      .read(f.frame_no);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::console_command_frame &f)
+  {
+    segments<Layout>::console_command::read(s, f);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::client_data_frame &f)
+  {
+    segments<Layout>::client_data::read(s, f);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::event_frame &f)
+  {
+    segments<Layout>::event::read(s, f);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::weapon_animation_frame &f)
+  {
+    segments<Layout>::weapon_animation::read(s, f);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::sound_frame &f)
+  {
+    segments<Layout>::sound_head::read(s, f);
+    s.read(f.sample, f.sample_size);
+    segments<Layout>::sound_tail::read(s, f);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::demo_buffer_frame &f)
+  {
+    segments<Layout>::demo_buffer::read(s, f);
+    s.read(f.buff, f.buff_len);
+  }
+
+  template<typename Layout, typename Stream>
+  void read(Stream &s, demo::game_data_frame &f)
+  {
+    segments<Layout>::game_data::read(s, f);
+
+    std::uint32_t data_len = 0;
+    s.read(data_len);
+    if (data_len != 0) {
+      f.data = s.read_bytes(data_len);
+    }
+  }
+
+  /* The string of a frame that is interned into ``demo::strings`` while
+   * parsing, as these repeat heavily across frames (and demos), or ``nullptr``
+   * for frames without one. */
+  template<typename Frame>
+  const std::string *interned_string(const Frame &f) noexcept
+  {
+    if constexpr (std::is_same_v<Frame, demo::console_command_frame>) {
+      return &f.command;
+    } else if constexpr (std::is_same_v<Frame, demo::sound_frame>) {
+      return &f.sample;
+    } else if constexpr (std::is_same_v<Frame, demo::game_data_frame>) {
+      return &f.demo_info.move_vars.sky_name;
+    } else {
+      return nullptr;
+    }
+  }
+
+  template<typename Frame>
+  string_table::id_t intern(string_table &strings, const Frame &f)
+  {
+    const auto *str = interned_string(f);
+    return str != nullptr ? strings.intern(*str) : string_table::none;
+  }
+
+  /* Encoders - the inverse of the above. Besides ``write(value)`` and
+   * ``write(str, sz)`` (as used by ``schema``), ``Sink`` needs
+   * ``write_bytes(data)``. */
+  template<typename Sink>
+  void write_header(Sink &s, const demo::frame &f)
+  {
+    s.write(f.type);
+    s.write(f.time);
+    s.write(f.frame_no);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::console_command_frame &f)
+  {
+    segments<Layout>::console_command::write(s, f);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::client_data_frame &f)
+  {
+    segments<Layout>::client_data::write(s, f);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::event_frame &f)
+  {
+    segments<Layout>::event::write(s, f);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::weapon_animation_frame &f)
+  {
+    segments<Layout>::weapon_animation::write(s, f);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::sound_frame &f)
+  {
+    segments<Layout>::sound_head::write(s, f);
+    s.write(f.sample, f.sample_size);
+    segments<Layout>::sound_tail::write(s, f);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::demo_buffer_frame &f)
+  {
+    segments<Layout>::demo_buffer::write(s, f);
+    s.write(f.buff, f.buff_len);
+  }
+
+  template<typename Layout, typename Sink>
+  void write(Sink &s, const demo::game_data_frame &f)
+  {
+    segments<Layout>::game_data::write(s, f);
+    s.write(static_cast<std::uint32_t>(f.data.size()));
+    s.write_bytes(f.data);
+  }
+
+  /* Writes a whole frame (header and, if it has one, segment). */
+  template<typename Layout, typename Sink, typename Frame>
+  void write_frame(Sink &s, const Frame &f)
+  {
+    write_header(s, f);
+    if constexpr (!std::is_same_v<Frame, demo::frame>) {
+      write<Layout>(s, f);
+    }
+  }
+
+  /* Reads the segment of the frame whose header is ``frame`` and passes the
+   * decoded frame to ``vis``, which must accept every frame type
+   * (``demo_start`` and ``next_section`` frames are passed as plain
+   * ``demo::frame``). Returns ``false`` once the end of the current directory
+   * entry has been reached. */
+  template<typename Layout, typename Stream, typename Visitor>
+  bool read_segment(Stream &s, const demo::frame &frame, Visitor &&vis)
+  {
+    switch (frame.type) {
+      case demo::frame::type_e::demo_start: {
+        vis(static_cast<const demo::frame &>(frame));
+        return true;
+      }
+
+      case demo::frame::type_e::console_command: {
+        demo::console_command_frame ccf(frame);
+        read<Layout>(s, ccf);
+        vis(static_cast<const demo::console_command_frame &>(ccf));
+        return true;
+      }
+
+      case demo::frame::type_e::client_data: {
+        demo::client_data_frame cdf(frame);
+        read<Layout>(s, cdf);
+        vis(static_cast<const demo::client_data_frame &>(cdf));
+        return true;
+      }
+
+      case demo::frame::type_e::next_section: {
+        vis(static_cast<const demo::frame &>(frame));
+        return false;
+      }
+
+      case demo::frame::type_e::event: {
+        demo::event_frame ef(frame);
+        read<Layout>(s, ef);
+        vis(static_cast<const demo::event_frame &>(ef));
+        return true;
+      }
+
+      case demo::frame::type_e::weapon_anim: {
+        demo::weapon_animation_frame waf(frame);
+        read<Layout>(s, waf);
+        vis(static_cast<const demo::weapon_animation_frame &>(waf));
+        return true;
+      }
+
+      case demo::frame::type_e::sound: {
+        demo::sound_frame sf(frame);
+        read<Layout>(s, sf);
+        vis(static_cast<const demo::sound_frame &>(sf));
+        return true;
+      }
+
+      case demo::frame::type_e::demo_buffer: {
+        demo::demo_buffer_frame dbf(frame);
+        read<Layout>(s, dbf);
+        vis(static_cast<const demo::demo_buffer_frame &>(dbf));
+        return true;
+      }
+
+      /* Game data (types: 0, 1) */
+      default: {
+        demo::game_data_frame gdf(frame);
+        read<Layout>(s, gdf);
+        vis(static_cast<const demo::game_data_frame &>(gdf));
+        return true;
+      }
+    }
+  }
+
+  /* Skips ``amt`` bytes, failing (as per the stream's error policy) just like
+   * reading them would. */
+  template<typename Stream>
+  void skip(Stream &s, std::uint64_t amt)
+  {
+    if (amt == 0) {
+      return;
+    }
+    if (amt > static_cast<std::uint64_t>(s.size()) - s.tell()) {
+      s.read_bytes(amt); // fails before copying anything
+    } else {
+      s.seek_bytes(amt, bit_buffer::seek_dir::cur);
+    }
+  }
+
+  /* Skips the segment of the frame whose header is ``frame``, reading but the
+   * lengths of its variable-size parts. Returns ``false`` if one of them is
+   * implausible (see ``try_read_frame``). */
+  template<typename Layout, typename Stream>
+  bool skip_segment(Stream &s, const demo::frame &frame)
+  {
+    switch (frame.type) {
+      case demo::frame::type_e::demo_start:
+      case demo::frame::type_e::next_section:
+        return true;
+
+      case demo::frame::type_e::console_command:
+        skip(s, Layout::console_command_size);
+        return true;
+
+      case demo::frame::type_e::client_data:
+        skip(s, Layout::client_data_size);
+        return true;
+
+      case demo::frame::type_e::event:
+        skip(s, Layout::event_size);
+        return true;
+
+      case demo::frame::type_e::weapon_anim:
+        skip(s, Layout::weapon_animation_size);
+        return true;
+
+      case demo::frame::type_e::sound: {
+        /* The sample size ends the head. */
+        std::int32_t sample_size = 0;
+        skip(s, Layout::sound_head_size - sizeof(sample_size));
+        s.read(sample_size);
+        if (sample_size < 0) {
+          return false;
+        }
+        skip(s, static_cast<std::uint64_t>(sample_size) + Layout::sound_tail_size);
+        return true;
+      }
+
+      case demo::frame::type_e::demo_buffer: {
+        std::int32_t buff_len = 0;
+        s.read(buff_len);
+        if (buff_len < 0) {
+          return false;
+        }
+        skip(s, static_cast<std::uint64_t>(buff_len));
+        return true;
+      }
+
+      /* Game data (types: 0, 1) */
+      default: {
+        std::uint32_t data_len = 0;
+        skip(s, Layout::demoinfo_size + Layout::sequence_info_size);
+        s.read(data_len);
+        skip(s, data_len);
+        return data_len <= DEMO_CONST(demo::game_data_frame, max_message_length);
+      }
+    }
+  }
+
+  /* Default filter of ``read_frame`` and ``try_read_frame``. */
+  struct decode_all
+  {
+    constexpr bool operator()(const demo::frame &) const noexcept
+    {
+      return true;
+    }
+  };
+
+  /* Reads a single frame (header and segment) - see ``read_segment``. Frames
+   * for whose header ``decode`` does not hold are skipped (see
+   * ``skip_segment``) and passed to ``vis`` as a plain ``demo::frame``. */
+  template<typename Layout, typename Stream, typename Visitor, typename Filter = decode_all>
+  bool read_frame(Stream &s, Visitor &&vis, Filter &&decode = {})
+  {
+    demo::frame frame;
+    read_header(s, frame);
+    if (!decode(static_cast<const demo::frame &>(frame))) {
+      skip_segment<Layout>(s, frame);
+      vis(static_cast<const demo::frame &>(frame));
+      return frame.type != demo::frame::type_e::next_section;
+    }
+    return read_segment<Layout>(s, frame, vis);
+  }
+
+  /* Like ``read_frame``, but for streams using ``bit_buffer::error_policy::record``:
+   * frames which are cut off or whose contents are implausible are reported
+   * as an error instead of being passed to ``vis``. The stream's error state is
+   * left for the caller to clear. */
+  template<typename Layout, typename Stream, typename Visitor, typename Filter = decode_all>
+  utils::expected<bool, demo::decode_error::code_e> try_read_frame(
+    Stream &s,
+    Visitor &&vis,
+    Filter &&decode = {}
+  )
+  {
+    using code_e = demo::decode_error::code_e;
+
+    demo::frame frame;
+    read_header(s, frame);
+    if (s.failed()) {
+      return utils::unexpected<code_e>{code_e::out_of_bounds};
+    }
+    if (
+      utils::to_underlying(frame.type) > utils::to_underlying(demo::frame::type_e::demo_buffer)
+    ) {
+      return utils::unexpected<code_e>{code_e::bad_frame};
+    }
+
+    if (!decode(static_cast<const demo::frame &>(frame))) {
+      const bool plausible = skip_segment<Layout>(s, frame);
+      if (s.failed()) {
+        return utils::unexpected<code_e>{code_e::out_of_bounds};
+      }
+      if (!plausible) {
+        return utils::unexpected<code_e>{code_e::bad_frame};
+      }
+      vis(static_cast<const demo::frame &>(frame));
+      return frame.type != demo::frame::type_e::next_section;
+    }
+
+    bool plausible = true;
+    const bool more = read_segment<Layout>(s, frame, [&](const auto &f) {
+      if (s.failed()) {
+        return;
+      }
+
+      using frame_t = std::remove_cvref_t<decltype(f)>;
+      if constexpr (std::is_same_v<frame_t, demo::sound_frame>) {
+        plausible = f.sample_size >= 0;
+      } else if constexpr (std::is_same_v<frame_t, demo::demo_buffer_frame>) {
+        plausible = f.buff_len >= 0;
+      } else if constexpr (std::is_same_v<frame_t, demo::game_data_frame>) {
+        plausible = f.data.size() <= DEMO_CONST(demo::game_data_frame, max_message_length);
+      }
+
+      if (plausible) {
+        vis(f);
+      }
+    });
+
+    if (s.failed()) {
+      return utils::unexpected<code_e>{code_e::out_of_bounds};
+    }
+    if (!plausible) {
+      return utils::unexpected<code_e>{code_e::bad_frame};
+    }
+    return more;
+  }
+} // namespace frames
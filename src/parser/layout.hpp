@@ -0,0 +1,70 @@
+#pragma once
+
+/* Compile-time description of the frame layout used by a given demo/network
+ * protocol pair. Decoders are instantiated per layout, and the layout matching
+ * a demo is selected once (after its header has been read), so that the frame
+ * loops themselves never branch on the protocol version. */
+
+#include <cstdint>
+#include <utility>
+
+#include "demo.hpp"
+
+#include "../utils/misc.hpp"
+
+template<demo::protocol_e DemProto, demo::protocol_e NetProto>
+struct frame_layout
+{
+  static constexpr auto dem_proto = DemProto;
+  static constexpr auto net_proto = NetProto;
+
+  /* All sizes listed as bytes. */
+  static constexpr std::uint32_t header_size = 9;
+  static constexpr std::uint32_t console_command_size =
+    DEMO_CONST(demo::frame, seg_console_command_size);
+  static constexpr std::uint32_t client_data_size =
+    DEMO_CONST(demo::frame, seg_client_data_size);
+  static constexpr std::uint32_t event_size = DEMO_CONST(demo::frame, seg_event_size);
+  static constexpr std::uint32_t weapon_animation_size =
+    DEMO_CONST(demo::frame, seg_weapon_animation_size);
+  static constexpr std::uint32_t sound_head_size = DEMO_CONST(demo::frame, seg_sound_size_1);
+  static constexpr std::uint32_t sound_tail_size = DEMO_CONST(demo::frame, seg_sound_size_2);
+  static constexpr std::uint32_t demo_buffer_size = DEMO_CONST(demo::frame, seg_demo_buffer_size);
+  static constexpr std::uint32_t demoinfo_size =
+    DEMO_CONST(demo::game_data_frame, demoinfo_size);
+  static constexpr std::uint32_t skyname_size =
+    DEMO_CONST(demo::game_data_frame, demoinfo_movevars_skyname_size);
+  static constexpr std::uint32_t sequence_info_size = 7 * sizeof(std::int32_t);
+  static constexpr std::uint32_t game_data_size =
+    DEMO_CONST(demo::frame, seg_game_data_size);
+
+  static_assert(
+    game_data_size == demoinfo_size + sequence_info_size + sizeof(std::uint32_t),
+    "game data segment must consist of demo info, sequence info and message length"
+  );
+};
+
+/* Layouts of all protocol versions known to the parser. Network protocols 47
+ * and 48 do not differ in any frame field, so they share a single layout (and
+ * thus a single instantiation of every decoder), tagged with the newer one. A
+ * layout of its own is only worth adding once a protocol's fields differ. */
+using layout_dem_5 = frame_layout<demo::protocol_e::dem_5, demo::protocol_e::net_48>;
+using default_layout = layout_dem_5;
+
+/* Calls ``f.template operator()<Layout>()`` with the layout matching the
+ * demo's protocols. Unknown versions are decoded using ``default_layout``,
+ * which matches the behaviour of the parser before layouts were introduced. */
+template<typename F>
+decltype(auto) with_frame_layout(const demo &d, F &&f)
+{
+  if (d.dem_proto == utils::to_underlying(demo::protocol_e::dem_5)) {
+    switch (d.net_proto) {
+      case utils::to_underlying(demo::protocol_e::net_47):
+      case utils::to_underlying(demo::protocol_e::net_48):
+        return std::forward<F>(f).template operator()<layout_dem_5>();
+
+      default: break;
+    }
+  }
+  return std::forward<F>(f).template operator()<default_layout>();
+}
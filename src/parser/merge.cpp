@@ -0,0 +1,78 @@
+#include "merge.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "demo.hpp"
+#include "follower.hpp"
+
+demo_merger::demo_merger(const std::vector<std::filesystem::path> &paths, const merge_options &opts)
+  : opts_(opts)
+{
+  follow_options fopts;
+  fopts.max_read = opts.max_read;
+  fopts.keep_index = false;
+
+  sources_.reserve(paths.size());
+  for (const auto &path : paths) {
+    sources_.emplace_back(path, fopts);
+  }
+  for (std::size_t i = 0; i != sources_.size(); ++i) {
+    schedule(i);
+  }
+}
+
+void demo_merger::schedule(std::size_t i)
+{
+  auto &src = sources_[i];
+  while (!src.done && (src.frames.empty() || !src.offset)) {
+    if (!src.offset && src.frames.size() >= opts_.max_lookahead) {
+      break;
+    }
+    const auto count = src.follower.poll([&](const auto &f) { push(src, f); }, 1);
+    if (count == 0 && (src.follower.finished() || src.follower.stalled())) {
+      src.done = true;
+    }
+  }
+
+  /* No server time to go by (yet), so fall back to the frame times. */
+  if (!src.offset && !src.frames.empty()) {
+    src.offset = 0.0f;
+    rekey(src);
+  }
+  if (!src.frames.empty()) {
+    heap_.push({src.frames.front().key, i});
+  }
+}
+
+template<typename Frame>
+void demo_merger::push(source &src, const Frame &f)
+{
+  if constexpr (std::is_same_v<Frame, demo::game_data_frame>) {
+    const auto server_time = f.demo_info.ref_params.time;
+    if (server_time > 0.0f) {
+      const bool first = !src.offset;
+      src.offset = server_time - f.time;
+      if (first) {
+        rekey(src);
+      }
+      src.frames.push_back({f, place(src, server_time)});
+      return;
+    }
+  }
+
+  src.frames.push_back({f, src.offset ? place(src, f.time + *src.offset) : 0.0f});
+}
+
+void demo_merger::rekey(source &src)
+{
+  for (auto &q : src.frames) {
+    const auto time = std::visit([](const demo::frame &f) { return f.time; }, q.frame);
+    q.key = place(src, time + *src.offset);
+  }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <variant>
+#include <vector>
+
+#include "demo.hpp"
+#include "follower.hpp"
+
+#include "../utils/bitbuffer.hpp"
+
+/* Any decoded frame, as passed to the visitors of ``frames::read_frame``. */
+using any_frame = std::variant<
+  demo::frame,
+  demo::console_command_frame,
+  demo::client_data_frame,
+  demo::event_frame,
+  demo::weapon_animation_frame,
+  demo::sound_frame,
+  demo::demo_buffer_frame,
+  demo::game_data_frame
+>;
+
+struct merge_options
+{
+  bit_buffer::size_t max_read = 1 << 20;  // bytes buffered per demo (plus the largest frame)
+  std::size_t max_lookahead = 1 << 12;    // frames decoded per demo while looking for its server time
+};
+
+/* Merges demos recorded from several points of view of the same game (e.g.
+ * one per player) into a single stream of frames ordered by server time.
+ *
+ * Frame times are local to every recording, so frames are placed on the
+ * server's timeline instead: game data frames by ``ref_params.time``, all
+ * other frames by their own time shifted by the offset between both as of
+ * the latest game data frame of their demo. Frames preceding the first game
+ * data frame are held back until it is found (up to
+ * ``merge_options::max_lookahead`` of them, past which the frame times are
+ * used as they are). Times never decrease within a demo, so that each demo's
+ * frames are passed on in file order.
+ *
+ * Every demo is decoded lazily by a ``demo_follower`` with bounded reads, and
+ * only its next frame takes part in the heap-based merge, hence memory use is
+ * proportional to the number of demos rather than to their size. Demos are
+ * assumed to be complete - one without a directory ends at its last complete
+ * frame. */
+class demo_merger
+{
+public:
+  explicit demo_merger(const std::vector<std::filesystem::path> &paths, const merge_options &opts = {});
+
+  /* Passes the next frame to ``vis(std::size_t demo, float server_time, const
+   * auto &frame)``, where ``demo`` indexes the paths given and ``frame`` is of
+   * any frame type (see ``frames::read_frame``). Frames of equal server time
+   * are ordered by ``demo``. Returns false once every demo is exhausted;
+   * raises a ``parser_error`` on malformed data. */
+  template<typename Visitor>
+  bool next(Visitor &&vis)
+  {
+    if (heap_.empty()) {
+      return false;
+    }
+
+    const auto top = heap_.top();
+    heap_.pop();
+    auto &src = sources_[top.source];
+    const auto q = std::move(src.frames.front());
+    src.frames.pop_front();
+    std::visit([&](const auto &f) { vis(top.source, q.key, f); }, q.frame);
+    schedule(top.source);
+    return true;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return sources_.size();
+  }
+
+  /* Header and entries of the ``i``th demo, as far as it was decoded. */
+  const demo &get_demo(std::size_t i) const noexcept
+  {
+    return sources_[i].follower.get_demo();
+  }
+
+private:
+  struct queued
+  {
+    any_frame frame;
+    float key = 0.0f;
+  };
+
+  struct source
+  {
+    explicit source(const std::filesystem::path &path, const follow_options &opts)
+      : follower(path, opts)
+    {
+    }
+
+    demo_follower follower;
+    std::deque<queued> frames;    // decoded, but not passed on yet
+    std::optional<float> offset;  // from frame time to server time
+    float last_key = 0.0f;
+    bool done = false;
+  };
+
+  struct heap_entry
+  {
+    float key = 0.0f;
+    std::size_t source = 0;
+
+    bool operator>(const heap_entry &other) const noexcept
+    {
+      return key != other.key ? key > other.key : source > other.source;
+    }
+  };
+
+  /* Decodes frames of the ``i``th demo until its next one is keyed and enters
+   * it into the heap. */
+  void schedule(std::size_t i);
+
+  template<typename Frame>
+  void push(source &src, const Frame &f);
+
+  /* Keys the frames held back so far once ``src.offset`` is known. */
+  static void rekey(source &src);
+
+  static float place(source &src, float key) noexcept
+  {
+    src.last_key = std::max(src.last_key, key);
+    return src.last_key;
+  }
+
+  merge_options opts_;
+  std::vector<source> sources_;
+  std::priority_queue<heap_entry, std::vector<heap_entry>, std::greater<heap_entry>> heap_;
+};
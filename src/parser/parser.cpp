@@ -2,20 +2,62 @@
 
 #include <filesystem>
 #include <cstdint>
+#include <memory>
+#include <utility>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
 
 #include "fmt/format.h"
 
 #include "demo.hpp"
+#include "frames.hpp"
+#include "layout.hpp"
 
 #include "../utils/bitbuffer.hpp"
+#include "../utils/instrument.hpp"
 #include "../utils/misc.hpp"
 
-parser::parser(const std::filesystem::path &demopath) : fdemo_(demopath)
+namespace
 {
+  /* Heuristics deciding whether a frame header read at an arbitrary offset
+   * (while resynchronizing after a decoding error) may follow ``prev``. */
+  constexpr float max_resync_time_gap = 60.0f; // seconds
+  constexpr std::uint32_t max_resync_frame_no_gap = 10000;
+  constexpr bit_buffer::size_t resync_check_interval = 4096; // bytes tried between checks of a ``parse_control``
+
+  bool is_plausible(const demo::frame &f, const demo::frame_index_entry &prev) noexcept
+  {
+    return
+      utils::to_underlying(f.type) <= utils::to_underlying(demo::frame::type_e::demo_buffer)
+      && std::isfinite(f.time)
+      && f.time >= prev.time
+      && f.time <= prev.time + max_resync_time_gap
+      && f.frame_no >= prev.frame_no
+      && f.frame_no - prev.frame_no <= max_resync_frame_no_gap;
+  }
+} // namespace
+
+parser::parser(
+  const std::filesystem::path &demopath,
+  mode_e mode,
+  std::shared_ptr<string_table> strings,
+  frames_e frames_mode,
+  hldp::parse_control *control
+) : fdemo_(demopath),
+    mode_(mode),
+    control_(control)
+{
+  demo_.strings = strings ? std::move(strings) : std::make_shared<string_table>();
+  if (mode_ == mode_e::tolerant) {
+    fdemo_.set_error_policy(bit_buffer::error_policy::record);
+  }
+
   static constexpr auto min_size = DEMO_CONST(demo, header_size) +
     static_cast<decltype(fdemo_.size())>(DEMO_CONST(demo, dir_entry_size)) *
     DEMO_CONST(demo, min_dir_entry_count);
-  if (fdemo_.size() < min_size) {
+  if (mode_ == mode_e::strict && fdemo_.size() < min_size) {
     throw parser_error(fmt::format(
       "demo size is less than (header_size + min_dir_entry_count * dir_entry_size " \
         "= {}B + {}B * {}B = {}B)",
@@ -26,14 +68,27 @@ parser::parser(const std::filesystem::path &demopath) : fdemo_(demopath)
     ));
   }
 
-  if (fdemo_.read<std::string>() != "HLDEMO") {
-    throw parser_error("bad demo signature");
+  /* A tolerant parse needs but the header, as the directory can be recovered. */
+  if (
+    fdemo_.size() < DEMO_CONST(demo, header_size)
+    || fdemo_.read<std::string>() != "HLDEMO"
+  ) {
+    if (mode_ == mode_e::strict) {
+      throw parser_error("bad demo signature");
+    }
+    demo_.errors.push_back({demo::decode_error::code_e::bad_header});
+    fdemo_.release_data();
+    return;
   }
 
   /* Parse some data without user input to retrieve preliminary information. */
+  const auto counters = instrument::local();
   parse_header();
   parse_directories();
-  parse_frames();
+  instrument::collect(stats_, counters);
+  if (frames_mode == frames_e::index) {
+    parse_frames(nullptr);
+  }
   fdemo_.release_data(); // release file data until there is further need of it
 }
 
@@ -42,9 +97,8 @@ void parser::parse_header()
   fdemo_
     .seek_bytes(DEMO_CONST(demo, header_signature_size))
     .read(demo_.dem_proto)
-    .read(demo_.net_proto);
-  fdemo_.read_string(DEMO_CONST(demo, header_mapname_size));
-  fdemo_
+    .read(demo_.net_proto)
+    .read(demo_.map_name, DEMO_CONST(demo, header_mapname_size))
     .read(demo_.game_dir, DEMO_CONST(demo, header_gamedir_size))
     .read(demo_.crc)
     .read(demo_.dir_offset);
@@ -60,12 +114,15 @@ void parser::parse_directories()
     dir_count < DEMO_CONST(demo, min_dir_entry_count)
     || dir_count > DEMO_CONST(demo, max_dir_entry_count)
   ) {
-    throw parser_error(fmt::format(
-      "invalid number of directory entries (expected between {} and {}, got {})",
-      DEMO_CONST(demo, min_dir_entry_count),
-      DEMO_CONST(demo, max_dir_entry_count),
-      dir_count
-    ));
+    if (mode_ == mode_e::strict) {
+      throw parser_error(fmt::format(
+        "invalid number of directory entries (expected between {} and {}, got {})",
+        DEMO_CONST(demo, min_dir_entry_count),
+        DEMO_CONST(demo, max_dir_entry_count),
+        dir_count
+      ));
+    }
+    dir_count = 0;
   }
 
   for (decltype(dir_count) i = 0; i != dir_count; ++i) {
@@ -86,257 +143,283 @@ void parser::parse_directories()
 
     demo_.dir_entries.push_back(std::move(e));
   }
+
+  if (mode_ == mode_e::tolerant) {
+    const bool valid = !demo_.dir_entries.empty() && !fdemo_.failed() && std::all_of(
+      demo_.dir_entries.cbegin(), demo_.dir_entries.cend(),
+      [size = fdemo_.size()](const auto &e) {
+        return e.offset >= DEMO_CONST(demo, header_size) && e.offset < size;
+      }
+    );
+    if (!valid) {
+      fdemo_.clear_error();
+      demo_.errors.push_back({
+        demo::decode_error::code_e::bad_directory,
+        0,
+        static_cast<bit_buffer::size_t>(demo_.dir_offset)
+      });
+      with_frame_layout(demo_, [this]<typename Layout>() { recover_directories<Layout>(); });
+    }
+  }
+}
+
+/* Rebuilds the directory of a demo whose own is missing (e.g. truncated
+ * demos) or broken, by walking the frames following the header and ending an
+ * entry at every ``next_section`` frame. Should the walk run into bad data,
+ * the last entry spans the rest of the file and is left for ``parse_frames``
+ * to resynchronize. */
+template<typename Layout>
+void parser::recover_directories()
+{
+  demo_.dir_entries.clear();
+  demo_.duration = 0.0f;
+
+  auto cur = fdemo_.cursor();
+  cur.set_error_policy(bit_buffer::error_policy::record);
+  const auto size = cur.size();
+  for (
+    bit_buffer::size_t pos = DEMO_CONST(demo, header_size);
+    pos < size && demo_.dir_entries.size() < DEMO_CONST(demo, max_dir_entry_count);
+  ) {
+    demo::directory_entry e;
+    e.type = demo_.dir_entries.empty()
+      ? demo::directory_entry::type_e::loading
+      : demo::directory_entry::type_e::playback;
+    e.offset = static_cast<std::int32_t>(pos);
+
+    cur.clear_error();
+    cur.seek_bytes(pos);
+    bool complete = false;
+    for (bool more = true; more; ) {
+      const auto res = frames::try_read_frame<Layout>(cur, [&](const auto &f) {
+        ++e.frames;
+        e.track_time = f.time;
+      });
+      if (!res) {
+        break;
+      }
+      more = *res;
+      complete = !more;
+    }
+
+    const auto end = complete ? cur.tell() : size;
+    e.file_length = static_cast<std::int32_t>(end - pos);
+    if (e.type == demo::directory_entry::type_e::playback) {
+      demo_.duration = e.track_time;
+    }
+    demo_.dir_entries.push_back(std::move(e));
+    pos = end;
+  }
 }
 
-void parser::parse_frames()
+demo_preview parser::preview(float resolution)
 {
+  if (!(resolution > 0.0f) || !std::isfinite(resolution)) {
+    throw parser_error(fmt::format("invalid preview resolution ({})", resolution));
+  }
+
+  demo_preview preview;
+  preview.resolution = resolution;
+  parse_frames(&preview);
+  return preview;
+}
+
+void parser::parse_frames(demo_preview *preview)
+{
+  /* There is no point in loading the demo for a parse that is cut off. */
+  if (control_ != nullptr) {
+    control_->start(fdemo_.size());
+    if (control_->check(0, true)) {
+      demo_.frame_index.clear();
+      return;
+    }
+  }
+
   /* Load demo into memory again, since we released it when parsing for
    * preliminary info. */
   if (!fdemo_.data_acquired()) {
     fdemo_.acquire_data();
   }
 
-  for (const auto &e : demo_.dir_entries) {
+  /* Select the decoders for the demo's protocol once, rather than per frame. */
+  const auto counters = instrument::local();
+  with_frame_layout(demo_, [&]<typename Layout>() { parse_frames<Layout>(preview); });
+  instrument::collect(stats_, counters);
+}
+
+template<typename Layout>
+void parser::parse_frames(demo_preview *preview)
+{
+  using code_e = demo::decode_error::code_e;
+  using type_e = demo::frame::type_e;
+
+  demo_.frame_index.clear();
+  demo_.frame_index.reserve(demo_.dir_entries.size());
+  std::erase_if(demo_.errors, [](const auto &err) {
+    return err.code == code_e::bad_frame || err.code == code_e::out_of_bounds;
+  });
+
+  /* Time buckets of the last client data and game data frames decoded when
+   * previewing. */
+  constexpr auto no_bucket = std::numeric_limits<std::int64_t>::min();
+  std::int64_t client_data_bucket = no_bucket;
+  std::int64_t game_data_bucket = no_bucket;
+  const auto decode = [&](const demo::frame &header) {
+    if (preview == nullptr) {
+      return true;
+    }
+    const bool client_data = header.type == type_e::client_data;
+    if ((!client_data && !frames::is_frame_of<demo::game_data_frame>(header.type)) || !std::isfinite(header.time)) {
+      return false;
+    }
+    /* Clamped before the cast, as tiny resolutions overflow the range. */
+    constexpr auto max_bucket = static_cast<float>(std::int64_t(1) << 62);
+    auto &last = client_data ? client_data_bucket : game_data_bucket;
+    const auto bucket = static_cast<std::int64_t>(std::clamp(
+      std::floor(header.time / preview->resolution), -max_bucket, max_bucket
+    ));
+    if (bucket == last) {
+      return false;
+    }
+    last = bucket;
+    return true;
+  };
+
+  /* Limits are checked before every frame, but the clock only every so many
+   * frames (see ``hldp::parse_control::check``). */
+  constexpr std::uint32_t timed_check_interval = 64;
+  std::uint32_t frames_read = 0;
+  const auto cut_off = [&](bit_buffer::size_t offset) {
+    return control_ != nullptr && control_->check(offset, ++frames_read % timed_check_interval == 0);
+  };
+
+  const auto size = static_cast<bit_buffer::size_t>(fdemo_.size());
+  bool stopped = false;
+  for (std::uint32_t i = 0; i != demo_.dir_entries.size() && !stopped; ++i) {
+    const auto &e = demo_.dir_entries[i];
+    auto &index = demo_.frame_index.emplace_back();
     fdemo_.seek_bytes(e.offset);
-    bool next_dir = false;
-    while (!next_dir) {
-      demo::frame frame;
-      fdemo_
-        .read(frame.type)
-        .read(frame.time)
-        .read(frame.frame_no);
-
-      switch (frame.type) {
-        case demo::frame::type_e::demo_start: {
-          break;
-        }
+    client_data_bucket = game_data_bucket = no_bucket;
+    for (bool next_dir = false; !next_dir; ) {
+      const auto offset = fdemo_.tell();
+      if (cut_off(offset)) {
+        stopped = true;
+        break;
+      }
 
-        case demo::frame::type_e::console_command: {
-          demo::console_command_frame ccf(frame);
-          fdemo_.read(ccf.command, DEMO_CONST(demo::frame, seg_console_command_size));
-          break;
+      const instrument::stopwatch sw;
+      const auto visit = [&](const auto &frame) {
+        if constexpr (instrument::enabled) {
+          /* Unknown types are decoded as game data, so count them as such. */
+          const auto type = utils::to_underlying(frame.type);
+          auto &fs = stats_.frames[type < stats_.frames.size() ? type : 1];
+          ++fs.count;
+          fs.bytes += fdemo_.tell() - offset;
+          fs.decode_ns += sw.elapsed_ns();
         }
 
-        case demo::frame::type_e::client_data: {
-          demo::client_data_frame cdf(frame);
-          fdemo_
-            .read(cdf.origin[0])
-            .read(cdf.origin[1])
-            .read(cdf.origin[2])
-            .read(cdf.viewangles[0])
-            .read(cdf.viewangles[1])
-            .read(cdf.viewangles[2])
-            .read(cdf.wpn_bits)
-            .read(cdf.fov);
-          break;
-        }
+        index.push_back({
+          frame.type, frame.time, frame.frame_no, frames::intern(*demo_.strings, frame), offset
+        });
 
-        case demo::frame::type_e::next_section: {
-          next_dir = true;
-          break;
+        using frame_t = std::remove_cvref_t<decltype(frame)>;
+        if constexpr (std::is_same_v<frame_t, demo::game_data_frame>) {
+          if (!frame.data.empty()) {
+            parse_net_data<Layout>(frame.data);
+          }
         }
-
-        case demo::frame::type_e::event: {
-          demo::event_frame ef(frame);
-          fdemo_
-            .read(ef.flags)
-            .read(ef.idx)
-            .read(ef.delay)
-            .read(ef.args.flags)
-            .read(ef.args.ent_idx)
-            .read(ef.args.origin[0])
-            .read(ef.args.origin[1])
-            .read(ef.args.origin[2])
-            .read(ef.args.angles[0])
-            .read(ef.args.angles[1])
-            .read(ef.args.angles[2])
-            .read(ef.args.velocity[0])
-            .read(ef.args.velocity[1])
-            .read(ef.args.velocity[2])
-            .read(ef.args.ducking)
-            .read(ef.args.fparams[0])
-            .read(ef.args.fparams[1])
-            .read(ef.args.iparams[0])
-            .read(ef.args.iparams[1])
-            .read(ef.args.bparams[0])
-            .read(ef.args.bparams[1]);
-          break;
+        if (preview != nullptr) {
+          if constexpr (std::is_same_v<frame_t, demo::client_data_frame>) {
+            preview->client_data.push_back(frame);
+          } else if constexpr (std::is_same_v<frame_t, demo::game_data_frame>) {
+            preview->game_data.push_back(frame);
+          }
         }
+      };
 
-        case demo::frame::type_e::weapon_anim: {
-          demo::weapon_animation_frame waf(frame);
-          fdemo_
-            .read(waf.anim)
-            .read(waf.body);
-          break;
-        }
+      if (mode_ == mode_e::strict) {
+        next_dir = !frames::read_frame<Layout>(fdemo_, visit, decode);
+        continue;
+      }
 
-        case demo::frame::type_e::sound: {
-          demo::sound_frame sf(frame);
-          fdemo_
-            .read(sf.channel)
-            .read(sf.sample_size)
-            .read(sf.sample, sf.sample_size)
-            .read(sf.attenuation)
-            .read(sf.volume)
-            .read(sf.flags)
-            .read(sf.pitch);
-          break;
-        }
+      const auto res = frames::try_read_frame<Layout>(fdemo_, visit, decode);
+      if (res) {
+        next_dir = !*res;
+        continue;
+      }
 
-        case demo::frame::type_e::demo_buffer: {
-          demo::demo_buffer_frame dbf(frame);
-          fdemo_
-            .read(dbf.buff_len)
-            .read(dbf.buff, dbf.buff_len);
-          break;
-        }
+      /* Skip ahead to the next intact-looking frame within this entry. */
+      fdemo_.clear_error();
+      const auto end = e.file_length > 0
+        ? std::min<bit_buffer::size_t>(size, e.offset + e.file_length)
+        : size;
+      const auto resumed = resync<Layout>(
+        offset + 1, end, index.empty() ? demo::frame_index_entry() : index.back()
+      );
+      demo_.errors.push_back({res.error(), i, offset, resumed});
+      if (resumed == 0) {
+        next_dir = true;
+        stopped = control_ != nullptr && control_->outcome() != hldp::parse_control::outcome_e::complete;
+      } else {
+        fdemo_.seek_bytes(resumed);
+      }
+    }
+  }
 
-        /* Game data (types: 0, 1) */
-        default: {
-          demo::game_data_frame gdf(frame);
-
-          fdemo_
-            .read(gdf.demo_info.timestamp)
-
-            .read(gdf.demo_info.ref_params.vieworg[0])
-            .read(gdf.demo_info.ref_params.vieworg[1])
-            .read(gdf.demo_info.ref_params.vieworg[2])
-            .read(gdf.demo_info.ref_params.viewangles[0])
-            .read(gdf.demo_info.ref_params.viewangles[1])
-            .read(gdf.demo_info.ref_params.viewangles[2])
-            .read(gdf.demo_info.ref_params.forward[0])
-            .read(gdf.demo_info.ref_params.forward[1])
-            .read(gdf.demo_info.ref_params.forward[2])
-            .read(gdf.demo_info.ref_params.right[0])
-            .read(gdf.demo_info.ref_params.right[1])
-            .read(gdf.demo_info.ref_params.right[2])
-            .read(gdf.demo_info.ref_params.up[0])
-            .read(gdf.demo_info.ref_params.up[1])
-            .read(gdf.demo_info.ref_params.up[2])
-            .read(gdf.demo_info.ref_params.frame_time)
-            .read(gdf.demo_info.ref_params.time)
-            .read(gdf.demo_info.ref_params.intermission)
-            .read(gdf.demo_info.ref_params.paused)
-            .read(gdf.demo_info.ref_params.spectator)
-            .read(gdf.demo_info.ref_params.onground)
-            .read(gdf.demo_info.ref_params.waterlevel)
-            .read(gdf.demo_info.ref_params.simvel[0])
-            .read(gdf.demo_info.ref_params.simvel[1])
-            .read(gdf.demo_info.ref_params.simvel[2])
-            .read(gdf.demo_info.ref_params.simorg[0])
-            .read(gdf.demo_info.ref_params.simorg[1])
-            .read(gdf.demo_info.ref_params.simorg[2])
-            .read(gdf.demo_info.ref_params.viewheight[0])
-            .read(gdf.demo_info.ref_params.viewheight[1])
-            .read(gdf.demo_info.ref_params.viewheight[2])
-            .read(gdf.demo_info.ref_params.ideal_pitch)
-            .read(gdf.demo_info.ref_params.cl_viewangles[0])
-            .read(gdf.demo_info.ref_params.cl_viewangles[1])
-            .read(gdf.demo_info.ref_params.cl_viewangles[2])
-            .read(gdf.demo_info.ref_params.health)
-            .read(gdf.demo_info.ref_params.crosshairangle[0])
-            .read(gdf.demo_info.ref_params.crosshairangle[1])
-            .read(gdf.demo_info.ref_params.crosshairangle[2])
-            .read(gdf.demo_info.ref_params.viewsize)
-            .read(gdf.demo_info.ref_params.punchangle[0])
-            .read(gdf.demo_info.ref_params.punchangle[1])
-            .read(gdf.demo_info.ref_params.punchangle[2])
-            .read(gdf.demo_info.ref_params.max_clients)
-            .read(gdf.demo_info.ref_params.viewentity)
-            .read(gdf.demo_info.ref_params.playernum)
-            .read(gdf.demo_info.ref_params.max_entities)
-            .read(gdf.demo_info.ref_params.demo_playback)
-            .read(gdf.demo_info.ref_params.hardware)
-            .read(gdf.demo_info.ref_params.smoothing)
-            .read(gdf.demo_info.ref_params.ptr_cmd)
-            .read(gdf.demo_info.ref_params.ptr_movevars)
-            .read(gdf.demo_info.ref_params.viewport[0])
-            .read(gdf.demo_info.ref_params.viewport[1])
-            .read(gdf.demo_info.ref_params.viewport[2])
-            .read(gdf.demo_info.ref_params.viewport[3])
-            .read(gdf.demo_info.ref_params.next_view)
-            .read(gdf.demo_info.ref_params.only_client_draw)
-
-            .read(gdf.demo_info.user_cmd.lerp_msec)
-            .read(gdf.demo_info.user_cmd.msec)
-            .read(gdf.demo_info.user_cmd.pad1)
-            .read(gdf.demo_info.user_cmd.viewangles[0])
-            .read(gdf.demo_info.user_cmd.viewangles[1])
-            .read(gdf.demo_info.user_cmd.viewangles[2])
-            .read(gdf.demo_info.user_cmd.forwardmove)
-            .read(gdf.demo_info.user_cmd.sidemove)
-            .read(gdf.demo_info.user_cmd.upmove)
-            .read(gdf.demo_info.user_cmd.lightlevel)
-            .read(gdf.demo_info.user_cmd.pad2)
-            .read(gdf.demo_info.user_cmd.buttons)
-            .read(gdf.demo_info.user_cmd.impulse)
-            .read(gdf.demo_info.user_cmd.weapon_select)
-            .read(gdf.demo_info.user_cmd.pad3[0])
-            .read(gdf.demo_info.user_cmd.pad3[1])
-            .read(gdf.demo_info.user_cmd.impact_idx)
-            .read(gdf.demo_info.user_cmd.impact_pos[0])
-            .read(gdf.demo_info.user_cmd.impact_pos[1])
-            .read(gdf.demo_info.user_cmd.impact_pos[2])
-
-            .read(gdf.demo_info.move_vars.gravity)
-            .read(gdf.demo_info.move_vars.stopspeed)
-            .read(gdf.demo_info.move_vars.maxspeed)
-            .read(gdf.demo_info.move_vars.spec_max_speed)
-            .read(gdf.demo_info.move_vars.accelerate)
-            .read(gdf.demo_info.move_vars.air_accelerate)
-            .read(gdf.demo_info.move_vars.water_accelerate)
-            .read(gdf.demo_info.move_vars.friction)
-            .read(gdf.demo_info.move_vars.edge_friction)
-            .read(gdf.demo_info.move_vars.water_friction)
-            .read(gdf.demo_info.move_vars.ent_gravity)
-            .read(gdf.demo_info.move_vars.bounce)
-            .read(gdf.demo_info.move_vars.step_size)
-            .read(gdf.demo_info.move_vars.max_velocity)
-            .read(gdf.demo_info.move_vars.z_max)
-            .read(gdf.demo_info.move_vars.wave_height)
-            .read(gdf.demo_info.move_vars.footsteps)
-            .read(
-              gdf.demo_info.move_vars.sky_name,
-              DEMO_CONST(demo::game_data_frame, demoinfo_movevars_skyname_size)
-            )
-            .read(gdf.demo_info.move_vars.roll_angle)
-            .read(gdf.demo_info.move_vars.roll_speed)
-            .read(gdf.demo_info.move_vars.sky_color[0])
-            .read(gdf.demo_info.move_vars.sky_color[1])
-            .read(gdf.demo_info.move_vars.sky_color[2])
-            .read(gdf.demo_info.move_vars.sky_vec[0])
-            .read(gdf.demo_info.move_vars.sky_vec[1])
-            .read(gdf.demo_info.move_vars.sky_vec[2])
-
-            .read(gdf.demo_info.view[0])
-            .read(gdf.demo_info.view[1])
-            .read(gdf.demo_info.view[2])
-            .read(gdf.demo_info.viewmodel)
-
-            .read(gdf.inc_sequence)
-            .read(gdf.inc_acknowledged)
-            .read(gdf.inc_rel_acknowledged)
-            .read(gdf.inc_rel_sequence)
-            .read(gdf.out_sequence)
-            .read(gdf.rel_sequence)
-            .read(gdf.last_rel_sequence);
-
-          std::uint32_t data_len = 0;
-          fdemo_.read(data_len);
-          if (data_len != 0) {
-            gdf.data = fdemo_.read_bytes(data_len);
-            parse_net_data(gdf.data);
-          }
+  if (control_ != nullptr && !stopped) {
+    control_->finish();
+  }
+}
 
-          break;
-        }
-      }
+/* Returns the first offset within ``[from; end)`` at which a frame that may
+ * follow ``prev`` decodes cleanly and is itself followed by a plausible frame
+ * header (or the end of the entry), or 0 if there is none or the parse was cut
+ * off meanwhile. */
+template<typename Layout>
+bit_buffer::size_t parser::resync(
+  bit_buffer::size_t from,
+  bit_buffer::size_t end,
+  const demo::frame_index_entry &prev
+) const
+{
+  auto cur = fdemo_.cursor();
+  cur.set_error_policy(bit_buffer::error_policy::record);
+  for (auto pos = from; pos + Layout::header_size <= end; ++pos) {
+    /* Garbage may go on for a while, so heed the limits of the parse. */
+    if (control_ != nullptr && (pos - from) % resync_check_interval == 0 && control_->check(pos, true)) {
+      return 0;
+    }
+
+    demo::frame f;
+    cur.clear_error();
+    cur.seek_bytes(pos);
+    frames::read_header(cur, f);
+    if (cur.failed() || !is_plausible(f, prev)) {
+      continue;
+    }
+
+    cur.seek_bytes(pos);
+    const auto res = frames::try_read_frame<Layout>(cur, [](const auto &) {});
+    if (!res) {
+      continue;
+    }
+    if (!*res || cur.tell() >= end) {
+      return pos;
+    }
+
+    demo::frame next;
+    frames::read_header(cur, next);
+    if (!cur.failed() && is_plausible(next, {f.type, f.time, f.frame_no, string_table::none, pos})) {
+      return pos;
     }
   }
+  return 0;
 }
 
-void parser::parse_net_data(const bit_buffer::data_t &data)
+/* No net message is decoded yet; decoders will pick their layout-dependent
+ * sizes from ``Layout`` like the frame decoders do. */
+template<typename Layout>
+void parser::parse_net_data([[maybe_unused]] const bit_buffer::data_t &data)
 {
 
 }
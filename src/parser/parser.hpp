@@ -2,35 +2,128 @@
 
 #include <stdexcept>
 #include <filesystem>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "hldp/control.hpp"
+#include "hldp/stats.hpp"
 
 #include "demo.hpp"
 
 #include "../utils/filebuffer.hpp"
 #include "../utils/bitbuffer.hpp"
+#include "../utils/stringtable.hpp"
 
 class parser_error : public std::runtime_error
 {
   using std::runtime_error::runtime_error;
 };
 
+/* Frames decoded by ``parser::preview``. */
+struct demo_preview
+{
+  float resolution = 0.0f;
+  std::vector<demo::client_data_frame> client_data;
+  std::vector<demo::game_data_frame> game_data;
+};
+
 class parser
 {
 public:
-  parser(const std::filesystem::path &demopath);
+  enum class mode_e : std::uint8_t
+  {
+    strict = 0, // any malformed data raises an exception
+    tolerant    // malformed data is recorded in ``demo::errors`` and skipped over
+  };
 
+  /* Whether the constructor goes through the frames right away. */
+  enum class frames_e : std::uint8_t
+  {
+    index = 0,  // ``demo::frame_index`` is filled in on construction
+    defer       // frames are left for ``parse`` or ``preview``
+  };
+
+  /* Note: in ``mode_e::tolerant``, only failing to open the file raises an
+   * exception - a demo whose header cannot be read is left empty, with the
+   * reason recorded in its ``errors``. Repeated strings of the frames are
+   * interned into ``strings`` (see ``demo::strings``), or into a table of the
+   * demo's own if none is given. Every pass over the frames (on construction,
+   * ``parse`` and ``preview``) is subject to ``control`` if given, which must
+   * outlive the parser, and keeps the frames read until it was cut off. */
+  parser(
+    const std::filesystem::path &demopath,
+    mode_e mode = mode_e::strict,
+    std::shared_ptr<string_table> strings = nullptr,
+    frames_e frames_mode = frames_e::index,
+    hldp::parse_control *control = nullptr
+  );
+
+  /* Parses all frames and keeps the demo data loaded afterwards, so that
+   * ``frame_reader``s may be created. Must not be called while any readers
+   * are in use. */
   void parse()
   {
-    parse_frames();
+    parse_frames(nullptr);
+  }
+
+  /* Like ``parse``, but only decodes the first client data and game data frame
+   * of every ``resolution`` seconds (within each directory entry), e.g. for
+   * thumbnails or timelines. All other frames are skipped by their size, and
+   * only their headers make it into the frame index (whose ``string_id``s
+   * are thus left unset). Frames whose time is not finite are skipped, and
+   * ``resolution`` must be positive and finite, or ``parser_error`` is
+   * thrown. */
+  demo_preview preview(float resolution);
+
+  /* Once constructed (and after ``parse``), the parser is not modified by any
+   * of the following, so they may be called concurrently. */
+  const demo &get_demo() const noexcept
+  {
+    return demo_;
+  }
+
+  const file_buffer &file() const noexcept
+  {
+    return fdemo_;
+  }
+
+  mode_e mode() const noexcept
+  {
+    return mode_;
+  }
+
+  /* Everything gathered over the parser's lifetime (see ``hldp::parse_stats``). */
+  hldp::parse_stats stats() const noexcept
+  {
+    auto s = stats_;
+    s += fdemo_.stats();
+    s.demos = 1;
+    return s;
   }
 
 private:
   void parse_header();
   void parse_directories();
-  void parse_frames();
+  template<typename Layout>
+  void recover_directories();
+  void parse_frames(demo_preview *preview);
+  template<typename Layout>
+  void parse_frames(demo_preview *preview);
+  template<typename Layout>
+  bit_buffer::size_t resync(
+    bit_buffer::size_t from,
+    bit_buffer::size_t end,
+    const demo::frame_index_entry &prev
+  ) const;
+  template<typename Layout>
   void parse_net_data(const bit_buffer::data_t &data);
 
   file_buffer fdemo_; // represents the demo file itself
   demo demo_;
+  mode_e mode_ = mode_e::strict;
+  hldp::parse_control *control_ = nullptr;
+  hldp::parse_stats stats_;
 
   bool prelim_info_gathered_ = false; // true if a valid local player has been obtained
 };
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "demo.hpp"
+#include "frames.hpp"
+#include "layout.hpp"
+#include "parser.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/filebuffer.hpp"
+
+/* A lightweight, per-thread cursor over an already parsed demo. The demo data,
+ * directory and frame index are shared (read-only) with the parser; only the
+ * read position is owned by the reader. Any number of readers over the same
+ * parser may be used concurrently without further synchronization. */
+class frame_reader
+{
+public:
+  explicit frame_reader(const parser &p)
+    : demo_(p.get_demo()),
+      storage_(p.file().storage()),
+      stream_(p.file().cursor())
+  {
+    if (storage_ == nullptr) {
+      throw parser_error("unable to create frame reader - demo data not loaded");
+    }
+  }
+
+  /* Decodes the frame at ``e`` and passes it to ``vis`` (see
+   * ``frames::read_frame``). */
+  template<typename Visitor>
+  void read_at(const demo::frame_index_entry &e, Visitor &&vis)
+  {
+    with_frame_layout(demo_, [&]<typename Layout>() { decode_at<Layout>(e, vis); });
+  }
+
+  /* Decodes all frames whose time lies within ``[from; to]``, in file order,
+   * and returns their count. Frame times are assumed not to decrease within a
+   * single directory entry, which allows for a binary search per entry. */
+  template<typename Visitor>
+  std::size_t for_each_in(float from, float to, Visitor &&vis)
+  {
+    return with_frame_layout(demo_, [&]<typename Layout>() {
+      std::size_t count = 0;
+      for (const auto &index : demo_.frame_index) {
+        auto it = std::partition_point(index.cbegin(), index.cend(),
+          [from](const auto &e) { return e.time < from; });
+        for (; it != index.cend() && it->time <= to; ++it, ++count) {
+          decode_at<Layout>(*it, vis);
+        }
+      }
+      return count;
+    });
+  }
+
+  /* Like ``for_each_in``, but only considers frames decoded into ``Frame``
+   * and only reads ``Fields`` of their segment (e.g.
+   * ``frames::ref_params_field<&frames::rp::vieworg>``), skipping the rest.
+   * Fields which are not projected keep their default values. ``vis`` may
+   * also take the frame's ``demo::frame_index_entry`` as a second argument,
+   * e.g. to revisit the frame later on. */
+  template<typename Frame, typename... Fields, typename Visitor>
+  std::size_t for_each_projected(float from, float to, Visitor &&vis)
+  {
+    return project<Frame, Fields...>([from, to](const auto &index) {
+      const auto first = std::partition_point(index.cbegin(), index.cend(),
+        [from](const auto &e) { return e.time < from; });
+      const auto last = std::find_if(first, index.cend(),
+        [to](const auto &e) { return !(e.time <= to); });
+      return std::make_pair(first, last);
+    }, vis);
+  }
+
+  /* Like the above, over every frame regardless of its time (which need not
+   * be ordered, nor even finite, in a corrupt demo). */
+  template<typename Frame, typename... Fields, typename Visitor>
+  std::size_t for_each_projected(Visitor &&vis)
+  {
+    return project<Frame, Fields...>([](const auto &index) {
+      return std::make_pair(index.cbegin(), index.cend());
+    }, vis);
+  }
+
+  const demo &get_demo() const noexcept
+  {
+    return demo_;
+  }
+
+private:
+  /* Projects the frames within the range ``select`` returns for every entry's
+   * index (see ``for_each_projected``). */
+  template<typename Frame, typename... Fields, typename Select, typename Visitor>
+  std::size_t project(Select &&select, Visitor &vis)
+  {
+    return with_frame_layout(demo_, [&]<typename Layout>() {
+      using projection_t =
+        typename frames::segment_of_t<Layout, Frame>::template project<Fields...>;
+
+      std::size_t count = 0;
+      for (const auto &index : demo_.frame_index) {
+        const auto [first, last] = select(index);
+        for (auto it = first; it != last; ++it) {
+          if (!frames::is_frame_of<Frame>(it->type)) {
+            continue;
+          }
+
+          demo::frame header;
+          stream_.seek_bytes(it->offset);
+          frames::read_header(stream_, header);
+
+          Frame f(header);
+          projection_t::read(stream_, f);
+          if constexpr (
+            std::is_invocable_v<Visitor &, const Frame &, const demo::frame_index_entry &>
+          ) {
+            vis(static_cast<const Frame &>(f), *it);
+          } else {
+            vis(static_cast<const Frame &>(f));
+          }
+          ++count;
+        }
+      }
+      return count;
+    });
+  }
+
+  template<typename Layout, typename Visitor>
+  void decode_at(const demo::frame_index_entry &e, Visitor &vis)
+  {
+    stream_.seek_bytes(e.offset);
+    frames::read_frame<Layout>(stream_, vis);
+  }
+
+  const demo &demo_;
+  file_buffer::storage_t storage_; // keeps the data alive for ``stream_``
+  bit_buffer stream_;
+};
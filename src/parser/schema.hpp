@@ -0,0 +1,208 @@
+#pragma once
+
+/* Declarative, compile-time description of fixed-size frame segments. A
+ * segment is described once as an ordered list of fields, each of which names
+ * its wire type and the chain of member pointers leading to it from the frame
+ * struct. From that description the decoder, the segment size and projections
+ * (decoders which only read a subset of fields and skip over the rest) are
+ * generated, as well as the matching encoder. */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "../utils/bitbuffer.hpp"
+
+namespace schema
+{
+  /* Wire type of a string stored in a fixed number of bytes. */
+  template<std::size_t N>
+  struct fixed_string
+  {
+  };
+
+  namespace detail
+  {
+    template<typename T>
+    struct member_type;
+
+    template<typename C, typename M>
+    struct member_type<M C::*>
+    {
+      using type = M;
+    };
+
+    template<auto... Path>
+    using member_t = typename member_type<
+      std::tuple_element_t<sizeof...(Path) - 1, std::tuple<decltype(Path)...>>
+    >::type;
+
+    template<typename Wire>
+    struct wire
+    {
+      static_assert(std::is_arithmetic_v<Wire>, "unsupported wire type");
+
+      static constexpr std::size_t size = sizeof(Wire);
+
+      template<typename Stream>
+      static void read(Stream &s, Wire &out)
+      {
+        s.read(out);
+      }
+
+      template<typename Sink>
+      static void write(Sink &s, const Wire &in)
+      {
+        s.write(in);
+      }
+    };
+
+    template<typename Wire, std::size_t N>
+    struct wire<Wire[N]>
+    {
+      static constexpr std::size_t size = wire<Wire>::size * N;
+
+      template<typename Stream>
+      static void read(Stream &s, Wire (&out)[N])
+      {
+        for (auto &v : out) {
+          wire<Wire>::read(s, v);
+        }
+      }
+
+      template<typename Sink>
+      static void write(Sink &s, const Wire (&in)[N])
+      {
+        for (const auto &v : in) {
+          wire<Wire>::write(s, v);
+        }
+      }
+    };
+
+    template<std::size_t N>
+    struct wire<fixed_string<N>>
+    {
+      static constexpr std::size_t size = N;
+
+      template<typename Stream>
+      static void read(Stream &s, std::string &out)
+      {
+        s.read(out, N);
+      }
+
+      template<typename Sink>
+      static void write(Sink &s, const std::string &in)
+      {
+        s.write(in, N);
+      }
+    };
+
+    template<typename T, typename... Ts>
+    inline constexpr bool contains_v = (std::is_same_v<T, Ts> || ...);
+  } // namespace detail
+
+  /* A field of wire type ``Wire``, reached from the frame through the member
+   * pointers in ``Path`` (e.g. ``&frame::demo_info, &demo_info_t::timestamp``). */
+  template<typename Wire, auto... Path>
+  struct basic_field
+  {
+    static_assert(sizeof...(Path) > 0, "field requires at least one member pointer");
+
+    using wire_t = Wire;
+
+    static constexpr std::size_t size = detail::wire<Wire>::size;
+
+    template<typename Frame>
+    static auto &get(Frame &f) noexcept
+    {
+      return (f .* ... .* Path);
+    }
+
+    template<typename Stream, typename Frame>
+    static void read(Stream &s, Frame &f)
+    {
+      detail::wire<Wire>::read(s, get(f));
+    }
+
+    template<typename Sink, typename Frame>
+    static void write(Sink &s, const Frame &f)
+    {
+      detail::wire<Wire>::write(s, get(f));
+    }
+  };
+
+  /* A field whose wire type is that of the member it is stored in. */
+  template<auto... Path>
+  using field = basic_field<detail::member_t<Path...>, Path...>;
+
+  template<typename Schema, typename... Selected>
+  struct projection;
+
+  template<typename Frame, typename... Fields>
+  struct segment
+  {
+    using frame_t = Frame;
+
+    /* Size on the wire, in bytes. */
+    static constexpr std::size_t size = (Fields::size + ...);
+
+    template<typename Stream>
+    static void read(Stream &s, Frame &f)
+    {
+      (Fields::read(s, f), ...);
+    }
+
+    template<typename Sink>
+    static void write(Sink &s, const Frame &f)
+    {
+      (Fields::write(s, f), ...);
+    }
+
+    template<typename Stream>
+    static void skip(Stream &s)
+    {
+      s.seek_bytes(size, bit_buffer::seek_dir::cur);
+    }
+
+    /* Decoder for the given subset of ``Fields`` only. */
+    template<typename... Selected>
+    using project = projection<segment, Selected...>;
+  };
+
+  template<typename Frame, typename... Fields, typename... Selected>
+  struct projection<segment<Frame, Fields...>, Selected...>
+  {
+    static_assert(
+      (detail::contains_v<Selected, Fields...> && ...),
+      "projected fields must be part of the segment"
+    );
+
+    using frame_t = Frame;
+    using segment_t = segment<Frame, Fields...>;
+
+    /* Reads the selected fields and skips over the others, leaving ``s`` at
+     * the end of the segment. Consecutive skipped fields are coalesced into a
+     * single seek whose length is known at compile time. */
+    template<typename Stream>
+    static void read(Stream &s, Frame &f)
+    {
+      bit_buffer::size_t pending = 0;
+      ([&] {
+        if constexpr (detail::contains_v<Fields, Selected...>) {
+          if (pending != 0) {
+            s.seek_bytes(pending, bit_buffer::seek_dir::cur);
+            pending = 0;
+          }
+          Fields::read(s, f);
+        } else {
+          pending += Fields::size;
+        }
+      }(), ...);
+      if (pending != 0) {
+        s.seek_bytes(pending, bit_buffer::seek_dir::cur);
+      }
+    }
+  };
+} // namespace schema
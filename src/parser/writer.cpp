@@ -0,0 +1,174 @@
+#include "writer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+
+#include "fmt/format.h"
+
+#include "demo.hpp"
+#include "frames.hpp"
+#include "layout.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/filebuffer.hpp"
+#include "../utils/misc.hpp"
+
+namespace
+{
+  /* Offset of ``dir_offset`` within the header. */
+  constexpr std::uint64_t dir_offset_pos = DEMO_CONST(demo, header_size) - sizeof(std::int32_t);
+
+  /* Offsets within the demo are stored as 32-bit signed integers. */
+  constexpr std::uint64_t max_demo_size = std::numeric_limits<std::int32_t>::max();
+
+  /* Offset just past the frame at ``e``. Only needed for the last frame of an
+   * entry lacking a ``next_section`` frame, hence decoding it is fine. */
+  template<typename Layout>
+  bit_buffer::size_t frame_end(const bit_buffer::data_t &data, const demo::frame_index_entry &e)
+  {
+    bit_buffer bb(data);
+    bb.set_error_policy(bit_buffer::error_policy::record);
+    bb.seek_bytes(e.offset);
+    frames::read_frame<Layout>(bb, [](const auto &) {});
+    return bb.failed() ? data.size() : bb.tell();
+  }
+} // namespace
+
+demo_writer::demo_writer(const std::filesystem::path &path, const bit_buffer::ubyte_t *header)
+  : ofs_(path, std::ios::binary)
+{
+  ofs_.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+  copy(header, dir_offset_pos);
+  staging_.write(std::int32_t(0)); // ``dir_offset``, patched in by ``finish``
+  copy(staging_.data().data(), staging_.size());
+}
+
+void demo_writer::begin_entry(const demo::directory_entry &e)
+{
+  entries_.push_back(e);
+  entries_.back().offset = static_cast<std::int32_t>(pos_);
+}
+
+void demo_writer::end_entry()
+{
+  auto &e = entries_.back();
+  e.file_length = static_cast<std::int32_t>(pos_ - e.offset);
+}
+
+void demo_writer::copy(const bit_buffer::ubyte_t *data, bit_buffer::size_t size)
+{
+  if (pos_ + size > max_demo_size) {
+    throw parser_error(fmt::format(
+      "unable to write demo - size would exceed {}B",
+      max_demo_size
+    ));
+  }
+  ofs_.write(reinterpret_cast<const char *>(data), size);
+  pos_ += size;
+}
+
+std::uint64_t demo_writer::finish()
+{
+  const auto dir_offset = static_cast<std::int32_t>(pos_);
+
+  staging_.clear();
+  staging_.write(static_cast<std::uint32_t>(entries_.size()));
+  for (const auto &e : entries_) {
+    staging_
+      .write(e.type)
+      .write(e.description, DEMO_CONST(demo, dir_entry_description_size))
+      .write(e.flags)
+      .write(e.cdtrack)
+      .write(e.track_time)
+      .write(e.frames)
+      .write(e.offset)
+      .write(e.file_length);
+  }
+  copy(staging_.data().data(), staging_.size());
+  const auto size = pos_;
+
+  staging_.clear();
+  staging_.write(dir_offset);
+  ofs_.seekp(dir_offset_pos);
+  ofs_.write(reinterpret_cast<const char *>(staging_.data().data()), staging_.size());
+  ofs_.close();
+  return size;
+}
+
+std::uint64_t cut_demo(
+  const parser &p,
+  float from,
+  float to,
+  const std::filesystem::path &out
+)
+{
+  using type_e = demo::frame::type_e;
+
+  /* The demo data is only kept loaded once ``parser::parse`` has been called. */
+  const auto storage = p.file().data_acquired()
+    ? p.file().storage()
+    : file_buffer(p.file().path()).storage();
+  if (storage == nullptr || storage->size() < DEMO_CONST(demo, header_size)) {
+    throw parser_error("unable to cut demo - no header");
+  }
+
+  const auto &d = p.get_demo();
+  const auto &data = *storage;
+
+  return with_frame_layout(d, [&]<typename Layout>() {
+    demo_writer w(out, data.data());
+    for (std::size_t i = 0; i != d.dir_entries.size() && i != d.frame_index.size(); ++i) {
+      const auto &index = d.frame_index[i];
+      auto e = d.dir_entries[i];
+
+      auto begin = index.cbegin();
+      auto end = index.cend();
+      auto lead = end; // ``demo_start`` frame kept in front of the cut range
+      bool terminated = begin != end && std::prev(end)->type == type_e::next_section;
+
+      if (e.type == demo::directory_entry::type_e::playback) {
+        if (begin != end && begin->type == type_e::demo_start) {
+          lead = begin++;
+        }
+        if (terminated) {
+          --end;
+          terminated = false;
+        }
+        begin = std::partition_point(begin, end, [from](const auto &f) { return f.time < from; });
+        end = std::partition_point(begin, end, [to](const auto &f) { return f.time <= to; });
+
+        e.track_time = begin != end ? std::prev(end)->time - begin->time : 0.0f;
+        e.frames = 0;
+        for (auto it = begin; it != end; ++it) {
+          e.frames += it == begin || it->frame_no != std::prev(it)->frame_no;
+        }
+      }
+
+      w.begin_entry(e);
+      if (lead != index.cend()) {
+        w.copy(data.data() + lead->offset, Layout::header_size);
+      }
+      if (begin != end) {
+        const auto from_offset = begin->offset;
+        const auto to_offset = end != index.cend()
+          ? end->offset
+          : frame_end<Layout>(data, *std::prev(end));
+        w.copy(data.data() + from_offset, to_offset - from_offset);
+      }
+      if (!terminated) {
+        demo::frame f;
+        f.type = type_e::next_section;
+        if (begin != end) {
+          f.time = std::prev(end)->time;
+          f.frame_no = std::prev(end)->frame_no;
+        }
+        w.write_frame<Layout>(f);
+      }
+      w.end_entry();
+    }
+    return w.finish();
+  });
+}
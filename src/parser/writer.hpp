@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "demo.hpp"
+#include "frames.hpp"
+#include "parser.hpp"
+
+#include "../utils/bitbuffer.hpp"
+#include "../utils/bitwriter.hpp"
+
+/* Writes a demo file entry by entry. Frames are either copied verbatim from
+ * already encoded data (see ``copy``) or encoded from their decoded form (see
+ * ``write_frame``); the directory and the header's ``dir_offset`` are written
+ * by ``finish``. */
+class demo_writer
+{
+public:
+  /* ``header`` must point to the ``demo::constants_e::header_size`` bytes of a
+   * demo header, which are copied verbatim (save for ``dir_offset``). */
+  demo_writer(const std::filesystem::path &path, const bit_buffer::ubyte_t *header);
+
+  /* Starts a new directory entry. Its ``offset`` and ``file_length`` are
+   * filled in by the writer, everything else is written as given. */
+  void begin_entry(const demo::directory_entry &e);
+  void end_entry();
+
+  void copy(const bit_buffer::ubyte_t *data, bit_buffer::size_t size);
+
+  template<typename Layout, typename Frame>
+  void write_frame(const Frame &f)
+  {
+    staging_.clear();
+    frames::write_frame<Layout>(staging_, f);
+    copy(staging_.data().data(), staging_.size());
+  }
+
+  /* Writes the directory and patches ``dir_offset``. Returns the total size
+   * of the demo. */
+  std::uint64_t finish();
+
+  std::uint64_t tell() const noexcept
+  {
+    return pos_;
+  }
+
+private:
+  std::ofstream ofs_;
+  bit_writer staging_;
+  std::vector<demo::directory_entry> entries_;
+  std::uint64_t pos_ = 0;
+};
+
+/* Writes the frames of ``p``'s playback entries whose time lies within
+ * ``[from; to]`` to a new demo at ``out``; other entries (i.e. loading) are
+ * kept whole. Frames are copied as contiguous byte ranges found via
+ * ``demo::frame_index`` and are not re-encoded, hence keep their original
+ * times. Each playback entry keeps its leading ``demo_start`` frame and is
+ * terminated by a new ``next_section`` frame. Returns the size of the new
+ * demo. */
+std::uint64_t cut_demo(
+  const parser &p,
+  float from,
+  float to,
+  const std::filesystem::path &out
+);
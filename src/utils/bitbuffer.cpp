@@ -1,10 +1,14 @@
 #include "bitbuffer.hpp"
 
+#include <bit>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "fmt/format.h"
 
+#include "instrument.hpp"
+
 static constexpr std::uint64_t mask_table[] =
 {
     0x0000000000000000, 0x0000000000000001, 0x0000000000000003,
@@ -31,36 +35,56 @@ static constexpr std::uint64_t mask_table[] =
     0x7FFFFFFFFFFFFFFF, 0xFFFFFFFFFFFFFFFF
 };
 
-bit_buffer::value_t bit_buffer::read_bits(ubyte_t amt) const
+bit_buffer::value_t bit_buffer::read_bits(ubyte_t amt)
 {
+  if constexpr (instrument::enabled) {
+    ++instrument::local().read_bits_calls;
+  }
   if (byte_ == nullptr) {
-    throw bit_buffer_error("unable to read bits - buffer exhausted (all bits processed)");
+    return fail(errc::exhausted, amt);
   }
   if (!is_remaining_n(amt)) {
-    throw bit_buffer_error(
-      fmt::format("unable to read specified amount ({}) of bits - exceeded buffer size", amt)
-    );
+    return fail(errc::out_of_range, amt);
   }
   if (amt > 64) {
-    throw bit_buffer_error(
-      fmt::format("cannot read more than 64 bits at a time ({} requested)", amt)
-    );
+    return fail(errc::bad_amount, amt);
   }
   if (amt == 0) {
     return 0;
   }
-  const auto ret = (*reinterpret_cast<const value_t *>(byte_) >> bit_pos_) & mask_table[amt];
+  /* Load a whole word, save for near the end, where that would overread. */
+  value_t word = 0;
+  const auto left = size_ - tell();
+  std::memcpy(&word, byte_, left < sizeof(word) ? left : sizeof(word));
+  const auto ret = (word >> bit_pos_) & mask_table[amt];
   skip_bits(amt);
   return ret;
 }
 
-bit_buffer::ubyte_t bit_buffer::read_bit() const
+bit_buffer::ubyte_t bit_buffer::read_bit()
 {
   return static_cast<ubyte_t>(read_bits(1));
 }
 
-bit_buffer::data_t bit_buffer::read_bytes(size_t amt) const
+bit_buffer::data_t bit_buffer::read_bytes(size_t amt)
 {
+  if (!is_remaining_bytes(amt)) {
+    /* Fail before allocating, as ``amt`` may well be garbage. */
+    fail(errc::out_of_range, amt * 8);
+    return {};
+  }
+  if constexpr (instrument::enabled) {
+    auto &c = instrument::local();
+    ++c.read_bytes_calls;
+    c.bytes_copied += amt;
+  }
+
+  if (bit_pos_ == 0 && byte_ != nullptr) {
+    data_t out(byte_, byte_ + amt);
+    skip_bits(amt * 8);
+    return out;
+  }
+
   data_t out;
   out.reserve(amt);
   for (size_t i = 0; i != amt; ++i) {
@@ -69,20 +93,38 @@ bit_buffer::data_t bit_buffer::read_bytes(size_t amt) const
   return out;
 }
 
-bit_buffer::ubyte_t bit_buffer::read_byte() const
+bit_buffer::ubyte_t bit_buffer::read_byte()
 {
   return static_cast<ubyte_t>(read_bits(8));
 }
 
 template<>
-float bit_buffer::read<float>() const
+float bit_buffer::read<float>()
 {
-  return *reinterpret_cast<float *>(read_bytes(sizeof(float)).data());
+  return std::bit_cast<float>(static_cast<std::uint32_t>(read_bits(sizeof(float) * 8)));
 }
 
 template<>
-std::string bit_buffer::read<std::string>() const
+std::string bit_buffer::read<std::string>()
 {
+  /* Byte-aligned strings (i.e. all but those within network messages) are
+   * found with ``memchr``, which libc implements with SIMD. */
+  if (bit_pos_ == 0 && byte_ != nullptr) {
+    const auto left = size_ - tell();
+    const auto *nul = static_cast<const ubyte_t *>(std::memchr(byte_, 0, left));
+    if (nul != nullptr) {
+      std::string str(reinterpret_cast<const char *>(byte_), nul - byte_);
+      skip_bits((str.size() + 1) * 8);
+      return str;
+    }
+
+    /* Unterminated - fail just like reading past the end byte by byte. */
+    std::string str(reinterpret_cast<const char *>(byte_), left);
+    skip_bits(left * 8);
+    read_byte();
+    return str;
+  }
+
   std::string str;
   for (ubyte_t b = 0; (b = read_byte()); ) {
     str += b;
@@ -90,13 +132,27 @@ std::string bit_buffer::read<std::string>() const
   return str;
 }
 
-std::string bit_buffer::read_string(std::string::size_type sz) const
+std::string bit_buffer::read_string(std::string::size_type sz)
 {
+  if (!is_remaining_bytes(sz)) {
+    fail(errc::out_of_range, sz * 8);
+    return {};
+  }
+
+  if (bit_pos_ == 0 && byte_ != nullptr) {
+    std::string str(reinterpret_cast<const char *>(byte_), sz);
+    skip_bits(sz * 8);
+    return str;
+  }
+
   std::string str(sz, '\0');
-  return str.assign(reinterpret_cast<const char *>(read_bytes(sz).data()), sz);
+  for (auto &c : str) {
+    c = static_cast<char>(read_byte());
+  }
+  return str;
 }
 
-void bit_buffer::skip_bits(size_t amt) const
+void bit_buffer::skip_bits(size_t amt)
 {
   if (!is_remaining_n(amt + 1)) {
     /* We skipped all remaining bits - set current byte to null to indicate
@@ -112,9 +168,9 @@ void bit_buffer::skip_bits(size_t amt) const
   }
 }
 
-void bit_buffer::skip_bytes(size_t amt) const
+void bit_buffer::skip_bytes(size_t amt)
 {
-  if (byte_ - buffer_.data() + amt > buffer_.size()) {
+  if (byte_ - data_ + amt > size_) {
     byte_ = nullptr;
     bit_pos_ = 0;
   } else {
@@ -122,15 +178,15 @@ void bit_buffer::skip_bytes(size_t amt) const
   }
 }
 
-void bit_buffer::skip_byte() const
+void bit_buffer::skip_byte()
 {
   skip_bytes(1);
 }
 
-void bit_buffer::seek_bytes(
+bit_buffer &bit_buffer::seek_bytes(
   size_t amt,
   seek_dir dir
-) const
+)
 {
   switch (dir) {
     case seek_dir::cur:
@@ -138,28 +194,60 @@ void bit_buffer::seek_bytes(
       break;
     
     case seek_dir::beg:
-      byte_ = buffer_.data();
+      byte_ = data_;
       bit_pos_ = 0;
       skip_bytes(amt);
       break;
     
     case seek_dir::end:
-      if (amt >= buffer_.size()) {
-        byte_ = buffer_.data();
+      if (amt >= size_) {
+        byte_ = data_;
         bit_pos_ = 0;
       } else {
-        byte_ = buffer_.data() + buffer_.size() - amt;
+        byte_ = data_ + size_ - amt;
         bit_pos_ = 7;
       }
       break;
 
     default: throw bit_buffer_error("invalid seek direction");
   }
+  return *this;
+}
+
+bit_buffer::value_t bit_buffer::fail(errc code, size_t amt)
+{
+  if (policy_ == error_policy::record) {
+    /* Only the first error is of interest - everything read afterwards is
+     * garbage anyway. */
+    if (error_.code == errc::none) {
+      error_ = {code, tell()};
+    }
+    byte_ = nullptr;
+    bit_pos_ = 0;
+    return 0;
+  }
+
+  switch (code) {
+    case errc::exhausted:
+      throw bit_buffer_error("unable to read bits - buffer exhausted (all bits processed)");
+
+    case errc::out_of_range:
+      throw bit_buffer_error(
+        fmt::format("unable to read specified amount ({}) of bits - exceeded buffer size", amt)
+      );
+
+    case errc::bad_amount:
+      throw bit_buffer_error(
+        fmt::format("cannot read more than 64 bits at a time ({} requested)", amt)
+      );
+
+    default: throw bit_buffer_error("unknown error");
+  }
 }
 
-void bit_buffer::align_byte() const
+void bit_buffer::align_byte()
 {
-  if (bit_pos_ > 0 && byte_ != buffer_.data()) {
+  if (bit_pos_ > 0 && byte_ != data_) {
     ++byte_;
     bit_pos_ = 0;
   }
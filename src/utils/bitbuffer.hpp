@@ -5,7 +5,6 @@
 #include <stdexcept>
 #include <cstdint>
 #include <vector>
-#include <istream>
 #include <string>
 
 class bit_buffer_error : public std::runtime_error
@@ -13,6 +12,11 @@ class bit_buffer_error : public std::runtime_error
   using std::runtime_error::runtime_error;
 };
 
+/* A read cursor over a contiguous block of bytes. The cursor does not own the
+ * bytes it reads - the owner (e.g. ``file_buffer``) must keep them alive for
+ * as long as the cursor is in use. Cursors are cheap to copy, and any number
+ * of them may read the same (immutable) bytes from different threads, as long
+ * as each thread uses its own cursor. */
 class bit_buffer
 {
 public:
@@ -29,62 +33,152 @@ public:
     end       // ... end towards the beginning
   };
 
-  bit_buffer(
-    std::istream &is,
-    const std::streamoff &bytes
-  ) : buffer_(bytes, '\0'),
-      byte_(buffer_.data())
+  /* What to do when a read cannot be satisfied. */
+  enum class error_policy : std::uint8_t
+  {
+    raise = 0,  // throw a ``bit_buffer_error``
+    record      // remember the (first) error, exhaust the cursor and yield zeroes
+  };
+
+  enum class errc : std::uint8_t
+  {
+    none = 0,
+    exhausted,    // read past the end of the buffer
+    out_of_range, // read would exceed the end of the buffer
+    bad_amount    // more than 64 bits requested at once
+  };
+
+  struct error_t
+  {
+    errc code = errc::none;
+    size_t offset = 0; // position of the cursor when the error occurred
+  };
+
+  bit_buffer() = default;
+
+  bit_buffer(const ubyte_t *data, size_t size) noexcept
+    : data_(data),
+      size_(size),
+      byte_(data)
+  {
+  }
+
+  explicit bit_buffer(const data_t &data) noexcept
+    : bit_buffer(data.data(), data.size())
   {
-    is.read(reinterpret_cast<char *>(buffer_.data()), bytes);
   }
 
   /* Read operations */
-  value_t read_bits(ubyte_t amt) const;
-  ubyte_t read_bit() const;
+  value_t read_bits(ubyte_t amt);
+  ubyte_t read_bit();
 
-  data_t read_bytes(size_t amt) const;
-  ubyte_t read_byte() const;
+  data_t read_bytes(size_t amt);
+  ubyte_t read_byte();
 
   template<typename T>
-  T read() const
+  T read()
   {
     return static_cast<T>(read_bits(sizeof(T) * 8));
   }
 
   template<typename T>
-  const bit_buffer &read(T &out) const
+  bit_buffer &read(T &out)
   {
     out = read<T>();
     return *this;
   }
 
-  template<>
-  float read<float>() const;
+  bit_buffer &read(std::string &out, std::string::size_type sz)
+  {
+    out = read_string(sz);
+    return *this;
+  }
 
-  template<>
-  std::string read<std::string>() const;
-  std::string read_string(std::string::size_type sz) const;
+  std::string read_string(std::string::size_type sz);
 
   /* Position operations */
-  void skip_bits(size_t amt) const;
-  void skip_bytes(size_t amt) const;
-  void skip_byte() const;
+  void skip_bits(size_t amt);
+  void skip_bytes(size_t amt);
+  void skip_byte();
 
-  void seek_bytes(
+  bit_buffer &seek_bytes(
     size_t amt,
     seek_dir dir = seek_dir::beg
-  ) const;
+  );
+
+  /* Error handling */
+  /* With ``error_policy::record``, reads never throw. Instead, the first error
+   * is kept (without any formatting or allocation) and can be checked at a
+   * convenient point, e.g. after decoding a whole frame. */
+  void set_error_policy(error_policy policy) noexcept
+  {
+    policy_ = policy;
+  }
+
+  error_policy get_error_policy() const noexcept
+  {
+    return policy_;
+  }
+
+  bool failed() const noexcept
+  {
+    return error_.code != errc::none;
+  }
+
+  const error_t &error() const noexcept
+  {
+    return error_;
+  }
+
+  void clear_error() noexcept
+  {
+    error_ = {};
+  }
 
   /* Auxiliaries */
-  void align_byte() const;
+  void align_byte();
 
   bool is_remaining_n(size_t bits) const noexcept
   {
-    return (byte_ - buffer_.data()) * 8 + bit_pos_ + bits <= buffer_.size() * 8;
+    return (byte_ - data_) * 8 + bit_pos_ + bits <= size_ * 8;
+  }
+
+  /* Current position in bytes from the beginning (``size()`` once exhausted). */
+  size_t tell() const noexcept
+  {
+    return byte_ == nullptr ? size_ : static_cast<size_t>(byte_ - data_);
+  }
+
+  size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  const ubyte_t *data() const noexcept
+  {
+    return data_;
   }
 
 private:
-  data_t buffer_;
-  mutable const ubyte_t *byte_ = nullptr;
-  mutable ubyte_t bit_pos_ = 0; // relative to the current byte ([0; 7])
+  bool is_remaining_bytes(size_t amt) const noexcept
+  {
+    return amt <= size_ - tell();
+  }
+
+  value_t fail(errc code, size_t amt);
+
+  const ubyte_t *data_ = nullptr;
+  size_t size_ = 0;
+
+  const ubyte_t *byte_ = nullptr;
+  ubyte_t bit_pos_ = 0; // relative to the current byte ([0; 7])
+
+  error_policy policy_ = error_policy::raise;
+  error_t error_;
 };
+
+template<>
+float bit_buffer::read<float>();
+
+template<>
+std::string bit_buffer::read<std::string>();
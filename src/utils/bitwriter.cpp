@@ -0,0 +1,66 @@
+#include "bitwriter.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "fmt/format.h"
+
+void bit_writer::write_bits(value_t val, ubyte_t amt)
+{
+  if (amt > 64) {
+    throw bit_buffer_error(
+      fmt::format("cannot write more than 64 bits at a time ({} requested)", amt)
+    );
+  }
+
+  /* Whole bytes at a byte boundary can be appended directly. */
+  if (bit_pos_ == 0 && amt % 8 == 0) {
+    for (; amt != 0; amt -= 8, val >>= 8) {
+      buffer_.push_back(static_cast<ubyte_t>(val));
+    }
+    return;
+  }
+
+  while (amt != 0) {
+    if (bit_pos_ == 0) {
+      buffer_.push_back(0);
+    }
+    const auto n = std::min<ubyte_t>(amt, 8 - bit_pos_);
+    buffer_.back() |= static_cast<ubyte_t>((val & ((1u << n) - 1)) << bit_pos_);
+    val >>= n;
+    amt -= n;
+    bit_pos_ = (bit_pos_ + n) % 8;
+  }
+}
+
+void bit_writer::write_bit(ubyte_t bit)
+{
+  write_bits(bit & 1, 1);
+}
+
+void bit_writer::write_bytes(const ubyte_t *data, size_t amt)
+{
+  if (bit_pos_ == 0) {
+    buffer_.insert(buffer_.end(), data, data + amt);
+    return;
+  }
+  for (size_t i = 0; i != amt; ++i) {
+    write_byte(data[i]);
+  }
+}
+
+void bit_writer::write_byte(ubyte_t byte)
+{
+  write_bits(byte, 8);
+}
+
+bit_writer &bit_writer::write(const std::string &str, std::string::size_type sz)
+{
+  const auto n = std::min(str.size(), sz);
+  write_bytes(reinterpret_cast<const ubyte_t *>(str.data()), n);
+  for (auto i = n; i != sz; ++i) {
+    write_byte(0);
+  }
+  return *this;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+/* Note: like ``bit_buffer``, assumes least significant bit to be on the right,
+ * i.e. whatever ``bit_buffer`` reads back is exactly what was written here. */
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "bitbuffer.hpp"
+
+class bit_writer
+{
+public:
+  using ubyte_t = bit_buffer::ubyte_t;
+  using value_t = bit_buffer::value_t;
+  using data_t = bit_buffer::data_t;
+  using size_t = bit_buffer::size_t;
+
+  bit_writer() = default;
+
+  explicit bit_writer(size_t reserve)
+  {
+    buffer_.reserve(reserve);
+  }
+
+  /* Write operations */
+  void write_bits(value_t val, ubyte_t amt);
+  void write_bit(ubyte_t bit);
+
+  void write_bytes(const ubyte_t *data, size_t amt);
+  void write_bytes(const data_t &data)
+  {
+    write_bytes(data.data(), data.size());
+  }
+  void write_byte(ubyte_t byte);
+
+  template<typename T>
+  bit_writer &write(const T &val)
+  {
+    if constexpr (std::is_enum_v<T>) {
+      return write(static_cast<std::underlying_type_t<T>>(val));
+    } else if constexpr (std::is_same_v<T, float>) {
+      write_bits(std::bit_cast<std::uint32_t>(val), sizeof(float) * 8);
+    } else {
+      static_assert(std::is_integral_v<T>, "unsupported type");
+      write_bits(static_cast<std::make_unsigned_t<T>>(val), sizeof(T) * 8);
+    }
+    return *this;
+  }
+
+  /* Writes exactly ``sz`` bytes of ``str``, padding with null bytes. */
+  bit_writer &write(const std::string &str, std::string::size_type sz);
+
+  /* Auxiliaries */
+  void align_byte() noexcept
+  {
+    bit_pos_ = 0;
+  }
+
+  /* Size in (started) bytes. */
+  size_t size() const noexcept
+  {
+    return buffer_.size();
+  }
+
+  const data_t &data() const noexcept
+  {
+    return buffer_;
+  }
+
+  data_t release() noexcept
+  {
+    bit_pos_ = 0;
+    return std::move(buffer_);
+  }
+
+  void clear() noexcept
+  {
+    buffer_.clear();
+    bit_pos_ = 0;
+  }
+
+private:
+  data_t buffer_;
+  ubyte_t bit_pos_ = 0; // next free bit of the last byte ([0; 7]; 0 if it is full)
+};
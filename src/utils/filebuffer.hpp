@@ -1,10 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <memory>
 
 #include "bitbuffer.hpp"
+#include "instrument.hpp"
 
 namespace utils
 {
@@ -19,9 +22,15 @@ namespace file
 } // namespace file
 } // namespace utils
 
+/* Owns the (immutable) contents of a file and a cursor for sequential reads
+ * over them. Additional independent cursors can be obtained via ``cursor()``;
+ * since the contents are never modified once loaded, such cursors may be used
+ * concurrently from different threads. */
 class file_buffer
 {
 public:
+  using storage_t = std::shared_ptr<const bit_buffer::data_t>;
+
   /* ``bytes == -1`` signifies that the whole file is to be read. */
   file_buffer(
     const std::filesystem::path &path,
@@ -41,60 +50,115 @@ public:
 
   /* Read operations */
   template<typename T>
-  T read() const
+  T read()
   {
-    return datastream_->read<T>();
+    return datastream_.read<T>();
   }
 
   template<typename T>
-  const file_buffer &read(T &out) const
+  file_buffer &read(T &out)
   {
-    datastream_->read(out);
+    datastream_.read(out);
     return *this;
   }
 
-  const file_buffer &read(std::string &out, std::string::size_type sz) const
+  file_buffer &read(std::string &out, std::string::size_type sz)
   {
-    out = datastream_->read_string(sz);
+    datastream_.read(out, sz);
     return *this;
   }
 
-  std::string read_string(std::string::size_type sz) const
+  std::string read_string(std::string::size_type sz)
   {
-    return datastream_->read_string(sz);
+    return datastream_.read_string(sz);
   }
 
-  bit_buffer::data_t read_bytes(bit_buffer::size_t amt) const
+  bit_buffer::data_t read_bytes(bit_buffer::size_t amt)
   {
-    return datastream_->read_bytes(amt);
+    return datastream_.read_bytes(amt);
   }
 
   /* Position operations */
-  const file_buffer &seek_bytes(
+  file_buffer &seek_bytes(
     bit_buffer::size_t amt,
     bit_buffer::seek_dir dir = bit_buffer::seek_dir::beg
-  ) const
+  )
   {
-    datastream_->seek_bytes(amt, dir);
+    datastream_.seek_bytes(amt, dir);
     return *this;
   }
 
+  bit_buffer::size_t tell() const noexcept
+  {
+    return datastream_.tell();
+  }
+
+  /* Error handling (see ``bit_buffer::error_policy``) */
+  void set_error_policy(bit_buffer::error_policy policy) noexcept
+  {
+    policy_ = policy;
+    datastream_.set_error_policy(policy);
+  }
+
+  bool failed() const noexcept
+  {
+    return datastream_.failed();
+  }
+
+  const bit_buffer::error_t &error() const noexcept
+  {
+    return datastream_.error();
+  }
+
+  void clear_error() noexcept
+  {
+    datastream_.clear_error();
+  }
+
+  /* Returns a new cursor positioned at the beginning of the data. Note that
+   * the cursor does not keep the data alive - see ``storage()``. */
+  bit_buffer cursor() const noexcept
+  {
+    return data_ ? bit_buffer(*data_) : bit_buffer();
+  }
+
+  /* Shared ownership of the loaded data, so that readers can outlive a
+   * subsequent ``release_data``. */
+  const storage_t &storage() const noexcept
+  {
+    return data_;
+  }
+
   /* Resource management */
   /* Note: ``acquire_data`` and ``release_data`` possibly violate RAII,
    * although they are used in but two instances (in the ``parser`` class). */
   bool data_acquired() const noexcept
   {
-    return datastream_.get() != nullptr;
+    return data_ != nullptr;
   }
 
-  void acquire_data(const std::streamoff &bytes = -1) const
+  void acquire_data(const std::streamoff &bytes = -1)
   {
-    datastream_ = std::make_unique<bit_buffer>(ifs_, bytes == -1 ? size_ : bytes);
+    const instrument::stopwatch sw;
+    bit_buffer::data_t data(bytes == -1 ? size_ : bytes);
+    ifs_.seekg(0);
+    ifs_.read(reinterpret_cast<char *>(data.data()), data.size());
+    data_ = std::make_shared<const bit_buffer::data_t>(std::move(data));
+    datastream_ = bit_buffer(*data_);
+    datastream_.set_error_policy(policy_);
+
+    if constexpr (instrument::enabled) {
+      ++stats_.loads;
+      stats_.load_ns += sw.elapsed_ns();
+      stats_.bytes_loaded += data_->size();
+      stats_.peak_buffer_bytes = std::max<std::uint64_t>(stats_.peak_buffer_bytes, data_->size());
+    }
   }
 
-  void release_data() const noexcept
+  void release_data() noexcept
   {
-    delete datastream_.release();
+    datastream_ = bit_buffer();
+    data_.reset();
   }
 
   /* Auxiliaries */
@@ -113,9 +177,18 @@ public:
     return size_;
   }
 
+  /* Loading statistics (only the file loading members are set). */
+  const hldp::parse_stats &stats() const noexcept
+  {
+    return stats_;
+  }
+
 private:
-  mutable std::ifstream ifs_;
-  const std::filesystem::path &path_;
+  std::ifstream ifs_;
+  const std::filesystem::path path_;
   std::streamoff size_ = 0;
-  mutable std::unique_ptr<bit_buffer> datastream_;
+  storage_t data_;
+  bit_buffer datastream_;
+  bit_buffer::error_policy policy_ = bit_buffer::error_policy::raise;
+  hldp::parse_stats stats_;
 };
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace utils
+{
+  /* Incremental XXH64 (https://github.com/Cyan4973/xxHash). Data is consumed
+   * in 32-byte stripes by four independent lanes, which keeps the multipliers
+   * busy enough for hashing to run at about memory bandwidth. ``digest`` does
+   * not alter the state, so that hashes of successive prefixes can be taken
+   * along the way. */
+  class xxh64
+  {
+  public:
+    explicit xxh64(std::uint64_t seed = 0) noexcept
+      : lanes_{seed + prime1 + prime2, seed + prime2, seed, seed - prime1},
+        seed_(seed)
+    {
+    }
+
+    xxh64 &update(const void *data, std::size_t len) noexcept
+    {
+      if (len == 0) {
+        return *this;
+      }
+      const auto *p = static_cast<const unsigned char *>(data);
+      total_ += len;
+
+      if (buffered_ != 0) {
+        const auto n = len < stripe_size - buffered_ ? len : stripe_size - buffered_;
+        std::memcpy(buffer_ + buffered_, p, n);
+        buffered_ += n;
+        p += n;
+        len -= n;
+        if (buffered_ != stripe_size) {
+          return *this;
+        }
+        consume(buffer_);
+        buffered_ = 0;
+      }
+
+      for (; len >= stripe_size; p += stripe_size, len -= stripe_size) {
+        consume(p);
+      }
+      std::memcpy(buffer_, p, len);
+      buffered_ = len;
+      return *this;
+    }
+
+    std::uint64_t digest() const noexcept
+    {
+      std::uint64_t h;
+      if (total_ >= stripe_size) {
+        h = rotl(lanes_[0], 1) + rotl(lanes_[1], 7) + rotl(lanes_[2], 12) + rotl(lanes_[3], 18);
+        for (const auto lane : lanes_) {
+          h ^= round(0, lane);
+          h = h * prime1 + prime4;
+        }
+      } else {
+        h = seed_ + prime5;
+      }
+      h += total_;
+
+      const unsigned char *p = buffer_;
+      auto len = buffered_;
+      for (; len >= 8; p += 8, len -= 8) {
+        h ^= round(0, load<std::uint64_t>(p));
+        h = rotl(h, 27) * prime1 + prime4;
+      }
+      if (len >= 4) {
+        h ^= load<std::uint32_t>(p) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+        len -= 4;
+      }
+      for (; len != 0; ++p, --len) {
+        h ^= *p * prime5;
+        h = rotl(h, 11) * prime1;
+      }
+
+      h ^= h >> 33;
+      h *= prime2;
+      h ^= h >> 29;
+      h *= prime3;
+      h ^= h >> 32;
+      return h;
+    }
+
+    static std::uint64_t of(const void *data, std::size_t len, std::uint64_t seed = 0) noexcept
+    {
+      return xxh64(seed).update(data, len).digest();
+    }
+
+  private:
+    static constexpr std::uint64_t prime1 = 0x9e3779b185ebca87;
+    static constexpr std::uint64_t prime2 = 0xc2b2ae3d27d4eb4f;
+    static constexpr std::uint64_t prime3 = 0x165667b19e3779f9;
+    static constexpr std::uint64_t prime4 = 0x85ebca77c2b2ae63;
+    static constexpr std::uint64_t prime5 = 0x27d4eb2f165667c5;
+    static constexpr std::size_t stripe_size = 32;
+
+    static constexpr std::uint64_t rotl(std::uint64_t x, int r) noexcept
+    {
+      return x << r | x >> (64 - r);
+    }
+
+    static constexpr std::uint64_t round(std::uint64_t acc, std::uint64_t input) noexcept
+    {
+      return rotl(acc + input * prime2, 31) * prime1;
+    }
+
+    /* Assumes a little-endian host, just like ``bit_buffer``. */
+    template<typename T>
+    static T load(const unsigned char *p) noexcept
+    {
+      T v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    void consume(const unsigned char *p) noexcept
+    {
+      for (std::size_t i = 0; i != 4; ++i) {
+        lanes_[i] = round(lanes_[i], load<std::uint64_t>(p + 8 * i));
+      }
+    }
+
+    std::uint64_t lanes_[4];
+    std::uint64_t seed_;
+    std::uint64_t total_ = 0;
+    unsigned char buffer_[stripe_size] = {};
+    std::size_t buffered_ = 0;
+  };
+} // namespace utils
@@ -0,0 +1,66 @@
+#pragma once
+
+/* Hot-path instrumentation (see ``hldp::parse_stats``). Everything in here
+ * compiles down to nothing unless the library is built with
+ * ``HLDP_INSTRUMENT``. */
+
+#include <chrono>
+#include <cstdint>
+
+#include "hldp/stats.hpp"
+
+namespace instrument
+{
+  inline constexpr bool enabled = hldp::parse_stats::enabled;
+
+  /* Bit reader counters. These are kept per thread, since cursors over the
+   * same data may be used from several threads at once. */
+  struct counters
+  {
+    std::uint64_t read_bits_calls = 0;
+    std::uint64_t read_bytes_calls = 0;
+    std::uint64_t bytes_copied = 0;
+  };
+
+  inline counters &local() noexcept
+  {
+    thread_local counters c;
+    return c;
+  }
+
+  /* Adds whatever was counted on this thread since ``before`` to ``out``. */
+  inline void collect(hldp::parse_stats &out, const counters &before) noexcept
+  {
+    const auto &now = local();
+    out.read_bits_calls += now.read_bits_calls - before.read_bits_calls;
+    out.read_bytes_calls += now.read_bytes_calls - before.read_bytes_calls;
+    out.bytes_copied += now.bytes_copied - before.bytes_copied;
+  }
+
+  class stopwatch
+  {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    stopwatch() noexcept
+    {
+      if constexpr (enabled) {
+        start_ = clock::now();
+      }
+    }
+
+    std::uint64_t elapsed_ns() const noexcept
+    {
+      if constexpr (enabled) {
+        return static_cast<std::uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start_).count()
+        );
+      } else {
+        return 0;
+      }
+    }
+
+  private:
+    clock::time_point start_;
+  };
+} // namespace instrument
@@ -0,0 +1,117 @@
+#include "mappedfile.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  define NOMINMAX
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace
+{
+  [[noreturn]] void raise(const std::filesystem::path &path, const char *what, int err)
+  {
+    throw std::filesystem::filesystem_error(what, path, std::error_code(err, std::system_category()));
+  }
+} // namespace
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::filesystem::path &path, access_e access)
+{
+  const DWORD flags = access == access_e::sequential
+    ? FILE_FLAG_SEQUENTIAL_SCAN
+    : access == access_e::random ? FILE_FLAG_RANDOM_ACCESS : FILE_ATTRIBUTE_NORMAL;
+  const HANDLE file = CreateFileW(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, flags, nullptr
+  );
+  if (file == INVALID_HANDLE_VALUE) {
+    raise(path, "unable to open file", static_cast<int>(GetLastError()));
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    const auto err = static_cast<int>(GetLastError());
+    CloseHandle(file);
+    raise(path, "unable to get file size", err);
+  }
+  size_ = static_cast<std::size_t>(size.QuadPart);
+
+  /* Empty files cannot be mapped (and need not be). */
+  if (size_ != 0) {
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr) {
+      data_ = static_cast<const std::uint8_t *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (data_ == nullptr) {
+      const auto err = static_cast<int>(GetLastError());
+      if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+      }
+      CloseHandle(file);
+      raise(path, "unable to map file", err);
+    }
+  }
+  CloseHandle(file);
+}
+
+mapped_file::~mapped_file()
+{
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+  }
+}
+
+#else
+
+mapped_file::mapped_file(const std::filesystem::path &path, access_e access)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    raise(path, "unable to open file", errno);
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    const auto err = errno;
+    ::close(fd);
+    raise(path, "unable to get file size", err);
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+
+  /* Empty files cannot be mapped (and need not be). */
+  if (size_ != 0) {
+    void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      const auto err = errno;
+      ::close(fd);
+      raise(path, "unable to map file", err);
+    }
+    data_ = static_cast<const std::uint8_t *>(p);
+
+    if (access != access_e::normal) {
+      ::posix_madvise(p, size_, access == access_e::sequential ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_RANDOM);
+    }
+  }
+  ::close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+  if (data_ != nullptr) {
+    ::munmap(const_cast<std::uint8_t *>(data_), size_);
+  }
+}
+
+#endif
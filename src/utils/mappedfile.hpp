@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+/* A read-only memory mapping of a whole file. Pages are only read once they
+ * are touched, so that sparse reads of large files cost just the pages
+ * involved. Raises ``std::filesystem::filesystem_error`` if the file cannot be
+ * opened or mapped. */
+class mapped_file
+{
+public:
+  /* How the mapping is going to be read, passed on to the OS as a hint. */
+  enum class access_e : std::uint8_t
+  {
+    normal = 0,
+    sequential,
+    random
+  };
+
+  explicit mapped_file(const std::filesystem::path &path, access_e access = access_e::normal);
+  ~mapped_file();
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  const std::uint8_t *data() const noexcept
+  {
+    return data_;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+private:
+  const std::uint8_t *data_ = nullptr;
+  std::size_t size_ = 0;
+#ifdef _WIN32
+  void *mapping_ = nullptr;
+#endif
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <type_traits>
+#include <utility>
 
 namespace utils
 {
@@ -9,4 +10,55 @@ namespace utils
   {
     return static_cast<std::underlying_type_t<T>>(val);
   }
+
+  template<typename E>
+  struct unexpected
+  {
+    E error;
+  };
+
+  /* Minimal stand-in for C++23's ``std::expected``: either a value or an
+   * error, without any exceptions involved. */
+  template<typename T, typename E>
+  class expected
+  {
+  public:
+    expected(T val) : value_(std::move(val)), has_value_(true)
+    {
+    }
+
+    expected(unexpected<E> err) : error_(std::move(err.error)), has_value_(false)
+    {
+    }
+
+    bool has_value() const noexcept
+    {
+      return has_value_;
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return has_value_;
+    }
+
+    const T &value() const noexcept
+    {
+      return value_;
+    }
+
+    const T &operator*() const noexcept
+    {
+      return value_;
+    }
+
+    const E &error() const noexcept
+    {
+      return error_;
+    }
+
+  private:
+    T value_{};
+    E error_{};
+    bool has_value_ = false;
+  };
 } // namespace utils
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+  /* Splits ``[0; n)`` into contiguous chunks, one per thread, each at least
+   * ``min_size`` long (save for the last one). */
+  struct chunks
+  {
+    std::size_t n = 0;
+    std::size_t count = 0;
+    std::size_t size = 0;
+
+    /* ``threads == 0`` uses every hardware thread. */
+    static chunks of(std::size_t n, unsigned threads, std::size_t min_size) noexcept
+    {
+      if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+      }
+      min_size = std::max<std::size_t>(min_size, 1);
+      const auto count = std::clamp<std::size_t>((n + min_size - 1) / min_size, 1, threads);
+      return {n, count, (n + count - 1) / count};
+    }
+
+    std::size_t begin(std::size_t i) const noexcept
+    {
+      return std::min(n, i * size);
+    }
+
+    std::size_t end(std::size_t i) const noexcept
+    {
+      return std::min(n, (i + 1) * size);
+    }
+  };
+
+  /* Calls ``f(i)`` for every chunk ``i``, each on its own thread (the first
+   * one on the calling thread), and returns once all of them are done. */
+  template<typename F>
+  void parallel_for(const chunks &c, F &&f)
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(c.count - 1);
+    for (std::size_t i = 1; i < c.count; ++i) {
+      workers.emplace_back([&f, i] { f(i); });
+    }
+    f(std::size_t(0));
+  }
+} // namespace utils
@@ -0,0 +1,49 @@
+#include "stringtable.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+
+namespace
+{
+  std::string_view until_nul(std::string_view str) noexcept
+  {
+    if (str.empty()) {
+      return str;
+    }
+    const auto *nul = static_cast<const char *>(std::memchr(str.data(), 0, str.size()));
+    return nul != nullptr ? str.substr(0, static_cast<std::size_t>(nul - str.data())) : str;
+  }
+} // namespace
+
+string_table::id_t string_table::intern(std::string_view str)
+{
+  str = until_nul(str);
+  {
+    const std::shared_lock lock(mutex_);
+    if (const auto it = ids_.find(str); it != ids_.cend()) {
+      return it->second;
+    }
+  }
+
+  /* Another thread may have added it in the meantime. */
+  const std::unique_lock lock(mutex_);
+  if (const auto it = ids_.find(str); it != ids_.cend()) {
+    return it->second;
+  }
+  const auto id = static_cast<id_t>(strings_.size());
+  ids_.emplace(strings_.emplace_back(str), id);
+  return id;
+}
+
+std::optional<string_table::id_t> string_table::find(std::string_view str) const
+{
+  str = until_nul(str);
+  const std::shared_lock lock(mutex_);
+  if (const auto it = ids_.find(str); it != ids_.cend()) {
+    return it->second;
+  }
+  return std::nullopt;
+}
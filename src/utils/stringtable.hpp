@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* Interns strings, handing out dense ids (in order of first appearance) which
+ * remain valid for the table's lifetime, as do the views returned by ``get``.
+ * A table may be shared by several parsers, even concurrently, so that equal
+ * strings get equal ids across demos. */
+class string_table
+{
+public:
+  using id_t = std::uint32_t;
+
+  static constexpr id_t none = std::numeric_limits<id_t>::max();
+
+  /* Strings are interned up to their first NUL, as fixed-size strings are
+   * padded with (and may contain garbage past) it. */
+  id_t intern(std::string_view str);
+
+  std::optional<id_t> find(std::string_view str) const;
+
+  std::string_view get(id_t id) const
+  {
+    const std::shared_lock lock(mutex_);
+    return strings_[id];
+  }
+
+  std::size_t size() const
+  {
+    const std::shared_lock lock(mutex_);
+    return strings_.size();
+  }
+
+private:
+  mutable std::shared_mutex mutex_;
+  std::deque<std::string> strings_;  // never relocated, unlike in a vector
+  std::unordered_map<std::string_view, id_t> ids_;
+};